@@ -2,31 +2,106 @@
 #define COMMAND_SYSTEM_H
 
 #include <Arduino.h>
+#include "ResponseBuilder.h"
 
-// Command callback function type
+// Non-owning view over part of a message (no copy, no terminator)
+struct StringView {
+  const char* data;
+  size_t length;
+
+  bool equalsIgnoreCase(const char* other) const;
+};
+
+// Typed argument kinds parsed by the tokenizer
+enum ArgType : uint8_t {
+  ARG_INT,       // Decimal integer within [min, max]
+  ARG_COLOR,     // #rrggbb or a color name, stored as 0xRRGGBB
+  ARG_DURATION,  // Number with ms/s/m suffix, stored in milliseconds within [min, max]
+  ARG_ENUM       // One of choices (nullptr-terminated), stored as its index
+};
+
+// Argument specification (arrays of these must outlive registration)
+struct ArgSpec {
+  const char* name;
+  ArgType type;
+  int32_t min;
+  int32_t max;
+  const char* const* choices;
+  bool optional;
+  bool withPrevious; // Optional, but required whenever the argument before it is given
+};
+
+// Parsed, validated arguments passed to typed commands
+class CommandArgs {
+public:
+  static const uint8_t MAX_ARGS = 4;
+
+  CommandArgs() : argCount(0) {}
+
+  uint8_t count() const { return argCount; }
+  bool has(uint8_t index) const { return index < argCount; }
+
+  int32_t getInt(uint8_t index, int32_t fallback = 0) const { return has(index) ? values[index] : fallback; }
+  uint32_t getColor(uint8_t index, uint32_t fallback = 0) const { return has(index) ? (uint32_t)values[index] : fallback; }
+  uint32_t getDuration(uint8_t index, uint32_t fallback = 0) const { return has(index) ? (uint32_t)values[index] : fallback; }
+  uint8_t getEnum(uint8_t index, uint8_t fallback = 0) const { return has(index) ? (uint8_t)values[index] : fallback; }
+
+private:
+  friend class CommandSystem;
+  int32_t values[MAX_ARGS];
+  uint8_t argCount;
+};
+
+// Command callback function types
 typedef void (*CommandCallback)(void);
+typedef void (*ArgsCommandCallback)(const CommandArgs& args);
 
 // Command structure
 struct Command {
   String name;
   String description;
   CommandCallback callback;
+  ArgsCommandCallback argsCallback;
+  const ArgSpec* args;
+  uint8_t argCount;
+  uint8_t cost; // Throttle tokens charged per use
 };
 
 class CommandSystem {
 private:
-  static const int MAX_COMMANDS = 20;
+  static const int MAX_COMMANDS = 24;
   Command commands[MAX_COMMANDS];
   int commandCount;
   
+  // Precomputed help reply payload
+  char* helpPayload;
+  size_t helpPayloadLength;
+  bool staticRepliesDirty;
+
+  // Tokenizer and argument validation
+  static bool nextToken(const char*& cursor, const char* end, StringView& token);
+  static bool nextCommandName(const char*& cursor, const char* end, StringView& name);
+  const Command* findCommand(const StringView& name) const;
+  static bool parseArg(const ArgSpec& spec, const StringView& token, int32_t& value);
+  static void describeArg(const ArgSpec& spec, char* buffer, size_t size);
+  static void formatUsage(const Command& command, char* buffer, size_t size);
+  bool parseArgs(const Command& command, const char* cursor, const char* end, CommandArgs& args) const;
+
 public:
   CommandSystem();
-  
+
   // Command management
   bool addCommand(const String& name, const String& description, CommandCallback callback);
-  void executeCommand(const String& command);
-  String getHelpText() const;
+  bool addCommand(const String& name, const String& description, const ArgSpec* args, uint8_t argCount, ArgsCommandCallback callback);
+  void executeCommand(const String& command) { executeCommand(command.c_str(), command.length()); }
+  void executeCommand(const char* command, size_t length);
+  void buildStaticReplies();
+  bool setCommandCost(const char* name, uint8_t cost);
+  uint8_t getCommandCost(const char* command, size_t length) const;
   
+  // Status embed shared by `status` and the live status message
+  static void writeStatusEmbed(ResponseBuilder& reply, const char* title, bool counters);
+
   // Command implementations
   static void statusCommand();
   static void turnOnCommand();
@@ -38,6 +113,15 @@ public:
   static void whiteCommand();
   static void offCommand();
   static void helpCommand();
+  static void latencyCommand();
+  static void colorCommand(const CommandArgs& args);
+  static void brightnessCommand(const CommandArgs& args);
+  static void flashCommand(const CommandArgs& args);
+  static void traceCommand(const CommandArgs& args);
+  static void shardCommand(const CommandArgs& args);
+  static void cancelCommand(const CommandArgs& args);
+  static void liveStatusCommand(const CommandArgs& args);
+  static void sendViaCommand(const CommandArgs& args);
 };
 
 // Global instance
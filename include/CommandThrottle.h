@@ -0,0 +1,84 @@
+#ifndef COMMAND_THROTTLE_H
+#define COMMAND_THROTTLE_H
+
+#include <Arduino.h>
+
+// Build with -DTHROTTLE_ENABLED=0 for raw throughput tests with the simulator
+#ifndef THROTTLE_ENABLED
+#define THROTTLE_ENABLED 1
+#endif
+
+// Token buckets: burst size and refill rate in tokens per second. A full
+// channel bucket admits at most burst + 5 s x refill = 4 commands in any 5 s
+// window, leaving room for one "slow down" notice under Discord's 5 messages
+// / 5 s per channel. The burst must cover the costliest command (trace, 3).
+#ifndef THROTTLE_USER_BURST
+#define THROTTLE_USER_BURST 3
+#endif
+#ifndef THROTTLE_USER_REFILL_PER_SEC
+#define THROTTLE_USER_REFILL_PER_SEC 0.25f
+#endif
+#ifndef THROTTLE_CHANNEL_BURST
+#define THROTTLE_CHANNEL_BURST 3
+#endif
+#ifndef THROTTLE_CHANNEL_REFILL_PER_SEC
+#define THROTTLE_CHANNEL_REFILL_PER_SEC 0.2f
+#endif
+
+// Minimum time between "slow down" replies, however many commands are dropped
+#ifndef THROTTLE_NOTICE_INTERVAL_MS
+#define THROTTLE_NOTICE_INTERVAL_MS 10000
+#endif
+
+enum ThrottleResult : uint8_t {
+  THROTTLE_ALLOW,   // Run the command
+  THROTTLE_NOTICE,  // Drop it and send the coalesced "slow down" reply
+  THROTTLE_DROP     // Drop it silently
+};
+
+// Token-bucket rate limiting of inbound commands, keyed by author and by
+// channel. Buckets live in a small fixed table; when it is full the least
+// recently used bucket is recycled (it refills to full on reuse, which only
+// ever favors the sender).
+class CommandThrottle {
+private:
+  static const int MAX_BUCKETS = 32;
+  
+  enum BucketKind : uint8_t {
+    BUCKET_FREE,
+    BUCKET_USER,
+    BUCKET_CHANNEL
+  };
+  
+  struct Bucket {
+    uint64_t key;
+    float tokens;
+    unsigned long refilledMs;
+    unsigned long usedMs;
+    BucketKind kind;
+  };
+  
+  Bucket buckets[MAX_BUCKETS];
+  unsigned long lastNoticeMs;
+  bool noticeSent;
+  uint32_t droppedCount;
+  uint32_t evictionCount;
+  
+  Bucket& acquire(BucketKind kind, uint64_t key, unsigned long now);
+  static void refill(Bucket& bucket, unsigned long now);
+  
+public:
+  CommandThrottle();
+  
+  // Charges cost tokens to both buckets, or neither if either is short
+  ThrottleResult admit(uint64_t authorId, uint64_t channelId, uint8_t cost);
+  
+  // Getters
+  uint32_t getDroppedCount() const { return droppedCount; }
+  uint32_t getEvictionCount() const { return evictionCount; }
+};
+
+// Global instance
+extern CommandThrottle commandThrottle;
+
+#endif
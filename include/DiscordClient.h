@@ -6,14 +6,45 @@
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 #include <Arduino.h>
+#include "ResponseBuilder.h"
+#include "TraceProfiler.h"
+#include "LatencyStats.h"
+#include "SendBackend.h"
+
+// Largest gateway frame the client accepts. GUILD_CREATE for a guild at
+// Discord's 500-channel limit runs to a few hundred KB; the WebSockets
+// library buffers the whole frame (in PSRAM) before the filtered parse.
+// WEBSOCKETS_MAX_DATA_SIZE in platformio.ini must be at least this.
+#ifndef GATEWAY_MAX_FRAME_BYTES
+#define GATEWAY_MAX_FRAME_BYTES (512 * 1024)
+#endif
+
+// Replies held while the channel's rate-limit bucket is empty; sent from update()
+#ifndef DEFERRED_REPLY_SLOTS
+#define DEFERRED_REPLY_SLOTS 4
+#endif
+
+// Receives finished reply payloads instead of the Discord REST API
+typedef bool (*ReplyHandler)(const char* payload, size_t length, uint64_t context);
+
+// Where replies go; a null handler means the Discord channel
+struct ReplyRoute {
+  ReplyHandler handler;
+  uint64_t context; // Handed back to the handler, e.g. the LAN caller address
+  
+  bool operator==(const ReplyRoute& other) const { return handler == other.handler && context == other.context; }
+};
 
 class DiscordClient {
 private:
   WiFiClientSecure httpClient;
+  WiFiClient simulatorClient; // Plain TCP client for the local simulator
   WebSocketsClient webSocket;
   String lastMessageId;
   String sessionId;
   String gatewayUrl;
+  String authorizationHeader;
+  ResponseBuilder response; // Shared preallocated send buffer
   int sequenceNumber;
   unsigned long lastHeartbeat;
   unsigned long heartbeatInterval;
@@ -23,16 +54,38 @@ private:
   unsigned long lastReadyTime;
   bool isConnected;
   bool isAuthenticated;
+  BotSendBackend botBackend;
+  WebhookSendBackend webhookBackend;
+  SendBackend* channelBackend; // Carries every message to DISCORD_CHANNEL_ID
+  String deferredReplies[DEFERRED_REPLY_SLOTS]; // FIFO, oldest at deferredHead
+  uint64_t deferredCreatedMs[DEFERRED_REPLY_SLOTS]; // commandCreatedMs of each reply
+  uint8_t deferredHead;
+  uint8_t deferredCount;
+  ReplyRoute replyRoute; // Overrides REST delivery for non-Discord callers
+  uint64_t commandCreatedMs; // Creation time of the message being handled
+  LatencyStats commandLatency;
+  uint16_t shardId;
+  uint16_t shardCount;
+  uint16_t maxConcurrency;
+  bool identifyPending;
+  unsigned long identifyPendingSince;
   
   // Helper methods
+  bool useSimulator() const;
+  void loadSendBackend();
+  bool deferReply(const char* payload, size_t length);
+  void sendDeferredReply();
+  void loadShardConfig();
+  bool isIdentifyAllowed() const;
   void getGatewayUrl();
   void connectWebSocket();
   void sendHeartbeat();
   void sendIdentify();
   void sendResume();
   void handleWebSocketEvent(WStype_t type, uint8_t * payload, size_t length);
-  void handleDiscordMessage(const String& eventType, JsonDocument& data);
-  void processMessage(JsonDocument& messageData);
+  void handleDiscordMessage(const String& eventType, JsonObject data);
+  void processMessage(JsonObject messageData);
+  void recordCommandLatency();
   
   // Static callback for WebSocket events
   static void webSocketEvent(WStype_t type, uint8_t * payload, size_t length);
@@ -44,13 +97,43 @@ public:
   // Core functions
   void begin();
   void update();
-  bool sendMessage(const String& message);
+  bool sendMessage(const char* message);
+  bool sendMessage(const String& message) { return sendMessage(message.c_str()); }
+  
+  // Zero-allocation replies: build into the shared buffer, then send
+  ResponseBuilder& beginResponse() { return response.begin(); }
+  bool sendResponse();
+  bool sendStaticReply(const char* payload) { return sendPayload(payload, strlen(payload)); }
+  bool sendPayload(const char* payload, size_t length);
+  
+  // Messages edited in place; these always go to the Discord channel
+  bool createMessage(const char* payload, size_t length, uint64_t& messageId);
+  int editMessage(uint64_t messageId, const char* payload, size_t length); // HTTP status, 404 if deleted
+  
+  // Route replies elsewhere while a command runs ({nullptr, 0} restores REST)
+  ReplyRoute setReplyRoute(const ReplyRoute& route);
+  const ReplyRoute& getReplyRoute() const { return replyRoute; }
+  
+  // End-to-end latency from message creation to reply (needs NTP time)
+  const LatencyStats& getCommandLatency() const { return commandLatency; }
   
   // Connection management
   bool isWebSocketConnected() const { return isConnected && isAuthenticated; }
   
+  // Sharding (config.cpp defaults, overridden by NVS)
+  uint16_t getShardId() const { return shardId; }
+  uint16_t getShardCount() const { return shardCount; }
+  uint16_t getMaxConcurrency() const { return maxConcurrency; }
+  bool saveShardConfig(uint16_t id, uint16_t count);
+  
+  // Send backend for the channel (bot REST or webhook, saved to NVS)
+  bool setSendBackend(bool useWebhook);
+  const SendBackend& getSendBackend() const { return *channelBackend; }
+  const SendBackend& getBotBackend() const { return botBackend; }
+  const SendBackend& getWebhookBackend() const { return webhookBackend; }
+  
 private:
-  void processNewMessage(const String& message);
+  void processNewMessage(const String& message, const String& messageId);
 };
 
 // Global instance
@@ -0,0 +1,160 @@
+#ifndef GUILD_CACHE_H
+#define GUILD_CACHE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Capacities (override with -D...). With the defaults the cache takes about
+// 261 KB of PSRAM, plus one extra string pool while compacting:
+//   guilds    64 x 12 B + 128 x 2 B index              =   1 KB
+//   channels  4096 x 17 B + 8192 x 2 B index           =  84 KB
+//   roles     2048 x 20 B + 4096 x 2 B index           =  48 KB
+//   strings   64 KB pool + 16384 x 4 B intern table    = 128 KB
+#ifndef GUILD_CACHE_MAX_GUILDS
+#define GUILD_CACHE_MAX_GUILDS 64
+#endif
+#ifndef GUILD_CACHE_MAX_CHANNELS
+#define GUILD_CACHE_MAX_CHANNELS 4096
+#endif
+#ifndef GUILD_CACHE_MAX_ROLES
+#define GUILD_CACHE_MAX_ROLES 2048
+#endif
+#ifndef GUILD_CACHE_POOL_BYTES
+#define GUILD_CACHE_POOL_BYTES 65536
+#endif
+
+// Lookup results (name pointers stay valid until the next cache update)
+struct CachedChannel {
+  uint64_t id;
+  uint64_t guildId;
+  const char* name;
+  uint8_t type;
+  uint16_t position;
+};
+
+struct CachedRole {
+  uint64_t id;
+  uint64_t guildId;
+  const char* name;
+  uint32_t color;
+  uint16_t position;
+};
+
+// Open-addressing snowflake -> row index map (linear probing, backward-shift
+// deletion so lookups never walk over tombstones)
+class SnowflakeIndex {
+public:
+  SnowflakeIndex() : slots(nullptr), mask(0) {}
+  
+  bool allocate(uint32_t capacity, size_t& bytes);
+  void clear();
+  int32_t find(const uint64_t* ids, uint64_t id) const;
+  void insert(uint64_t id, uint16_t row);
+  void remove(const uint64_t* ids, uint64_t id);
+  void move(const uint64_t* ids, uint64_t id, uint16_t row);
+  
+private:
+  uint16_t* slots; // row + 1, 0 = empty
+  uint32_t mask;
+  
+  uint32_t home(uint64_t id) const;
+  int32_t findSlot(const uint64_t* ids, uint64_t id) const;
+};
+
+// Structure-of-arrays cache of guild, channel and role metadata, fed
+// incrementally by gateway dispatches. Names are interned in one string
+// pool, so repeated names like "general" are stored once.
+class GuildCache {
+public:
+  static const uint16_t MAX_GUILDS = GUILD_CACHE_MAX_GUILDS;
+  static const uint16_t MAX_CHANNELS = GUILD_CACHE_MAX_CHANNELS;
+  static const uint16_t MAX_ROLES = GUILD_CACHE_MAX_ROLES;
+  static const uint32_t POOL_BYTES = GUILD_CACHE_POOL_BYTES;
+  static const size_t MAX_NAME_BYTES = 100;
+  
+  GuildCache();
+  
+  // Allocates all tables up front (PSRAM when available)
+  bool begin();
+  void clear();
+  
+  // Applies READY, GUILD_*, GUILD_ROLE_* and CHANNEL_* dispatches
+  void handleDispatch(const String& eventType, JsonObject data);
+  
+  // Direct updates (return false when full or the guild is unknown)
+  bool upsertGuild(uint64_t id, const char* name);
+  bool upsertChannel(uint64_t id, uint64_t guildId, const char* name, uint8_t type, uint16_t position);
+  bool upsertRole(uint64_t id, uint64_t guildId, const char* name, uint32_t color, uint16_t position);
+  void removeGuild(uint64_t id);
+  void removeChannel(uint64_t id);
+  void removeRole(uint64_t id);
+  
+  // Constant-time lookups
+  const char* getGuildName(uint64_t id) const;
+  bool getChannel(uint64_t id, CachedChannel& channel) const;
+  bool getRole(uint64_t id, CachedRole& role) const;
+  
+  // Getters
+  bool isReady() const { return poolData != nullptr; }
+  uint16_t getGuildCount() const { return guildCount; }
+  uint16_t getChannelCount() const { return channelCount; }
+  uint16_t getRoleCount() const { return roleCount; }
+  uint32_t getPoolUsed() const { return poolUsed; }
+  size_t getMemoryBytes() const { return memoryBytes; }
+  uint32_t getDroppedCount() const { return droppedCount; }
+  
+  static uint64_t parseSnowflake(const char* text);
+  
+private:
+  // Guild rows
+  uint64_t* guildIds;
+  uint32_t* guildNames;
+  uint16_t guildCount;
+  SnowflakeIndex guildIndex;
+  
+  // Channel rows
+  uint64_t* channelIds;
+  uint16_t* channelGuilds;
+  uint32_t* channelNames;
+  uint8_t* channelTypes;
+  uint16_t* channelPositions;
+  uint16_t channelCount;
+  SnowflakeIndex channelIndex;
+  
+  // Role rows
+  uint64_t* roleIds;
+  uint16_t* roleGuilds;
+  uint32_t* roleNames;
+  uint32_t* roleColors;
+  uint16_t* rolePositions;
+  uint16_t roleCount;
+  SnowflakeIndex roleIndex;
+  
+  // Interned strings (offset 0 is the empty string)
+  char* poolData;
+  uint32_t poolUsed;
+  uint32_t* internSlots; // offset + 1, 0 = empty
+  uint32_t internMask;
+  uint32_t internCount;
+  uint32_t deadBytes; // Released by renames and removals since the last compaction;
+  uint32_t deadCount; // an upper bound, since a released name may still be shared
+  bool compacting;
+  
+  size_t memoryBytes;
+  uint32_t droppedCount;
+  
+  uint32_t intern(const char* text);
+  bool hasRoom(size_t length) const;
+  bool compactionMayHelp(size_t length) const;
+  bool compact();
+  void release(uint32_t offset);
+  void removeChannelRow(uint16_t row);
+  void removeRoleRow(uint16_t row);
+  void upsertChannelJson(uint64_t guildId, JsonObject channel);
+  void upsertRoleJson(uint64_t guildId, JsonObject role);
+};
+
+// Global instance
+extern GuildCache guildCache;
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <Arduino.h>
+#include "DiscordClient.h"
+
+// Outcome of a job step; anything but JOB_RUNNING ends the job
+enum JobStatus : uint8_t {
+  JOB_RUNNING,
+  JOB_DONE,
+  JOB_FAILED,
+  JOB_CANCELLED
+};
+
+struct Job;
+
+// Advances the job's state machine by one step. Steps must not block:
+// keep progress in job.state and call job.sleep() to wait.
+typedef JobStatus (*JobStep)(Job& job);
+
+// Called exactly once when the job ends (done, failed or cancelled)
+typedef void (*JobFinish)(Job& job, JobStatus status);
+
+struct Job {
+  uint16_t id; // 0 = free slot
+  const char* name; // Must be long-lived (string literal)
+  JobStep step;
+  JobFinish finish;
+  ReplyRoute route; // Captured at start so replies reach the original caller
+  uint8_t state;
+  uint8_t progress; // Percent, shown by `cancel`
+  int32_t arg;
+  unsigned long startedMs;
+  unsigned long wakeAtMs;
+  
+  void sleep(unsigned long ms) { wakeAtMs = millis() + ms; }
+};
+
+// Runs long commands as resumable jobs from the main loop, so the command
+// dispatcher returns to the gateway right away. Each update gives every
+// ready job one step with its reply route restored.
+class JobScheduler {
+public:
+  static const uint8_t MAX_JOBS = 4;
+  
+  JobScheduler();
+  
+  // Starts a job on the current reply route; replies and returns 0 when full
+  uint16_t start(const char* name, JobStep step, JobFinish finish, int32_t arg = 0);
+  void update();
+  bool cancel(uint16_t id);
+  
+  // Lookups
+  const Job* find(uint16_t id) const;
+  const Job* findByName(const char* name) const;
+  const Job* getSlot(uint8_t slot) const { return jobs[slot].id ? &jobs[slot] : nullptr; }
+  uint8_t getActiveCount() const;
+  
+private:
+  Job jobs[MAX_JOBS];
+  uint16_t nextId;
+  
+  void end(Job& job, JobStatus status);
+};
+
+// Global instance
+extern JobScheduler jobScheduler;
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <Arduino.h>
+
+// Running latency aggregate used to compare command paths
+struct LatencyStats {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  
+  LatencyStats() : count(0), totalUs(0), maxUs(0), lastUs(0) {}
+  
+  void add(uint32_t us) {
+    count++;
+    totalUs += us;
+    lastUs = us;
+    if (us > maxUs) maxUs = us;
+  }
+  uint32_t averageUs() const { return count ? (uint32_t)(totalUs / count) : 0; }
+};
+
+#endif
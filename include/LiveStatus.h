@@ -0,0 +1,68 @@
+#ifndef LIVE_STATUS_H
+#define LIVE_STATUS_H
+
+#include <Arduino.h>
+
+// How often the status is rendered and compared with the last published one
+#ifndef LIVE_STATUS_POLL_MS
+#define LIVE_STATUS_POLL_MS 1000
+#endif
+
+// A change is published once the status has been stable this long, which
+// folds LED toggles and short reconnects into a single edit
+#ifndef LIVE_STATUS_DEBOUNCE_MS
+#define LIVE_STATUS_DEBOUNCE_MS 2000
+#endif
+
+// Minimum time between two edits, and the longest a change may wait when
+// the status never settles
+#ifndef LIVE_STATUS_MIN_EDIT_MS
+#define LIVE_STATUS_MIN_EDIT_MS 5000
+#endif
+#ifndef LIVE_STATUS_MAX_DELAY_MS
+#define LIVE_STATUS_MAX_DELAY_MS 15000
+#endif
+
+// Keeps one status message in the channel up to date. The message is posted
+// once and then edited with PATCH only when the rendered embed changes, so a
+// steady state costs no requests at all. The message id survives reboots.
+class LiveStatus {
+private:
+  uint64_t messageId;
+  uint32_t sentHash;     // Hash of the payload currently shown in Discord
+  uint32_t pendingHash;  // Hash of the latest render
+  unsigned long lastPollMs;
+  unsigned long changedMs;     // When pendingHash last changed
+  unsigned long dirtySinceMs;  // When the render first differed from sentHash
+  unsigned long lastEditMs;
+  bool enabled;
+  bool dirty;
+  bool forcePublish;
+  uint32_t createCount;
+  uint32_t editCount;
+  uint32_t skippedCount;
+  
+  bool publish(const char* payload, size_t length);
+  void save();
+  static uint32_t hashPayload(const char* payload, size_t length);
+  
+public:
+  LiveStatus();
+  
+  // Core functions
+  void begin();
+  void update();
+  void setEnabled(bool on);
+  
+  // Getters
+  bool isEnabled() const { return enabled; }
+  uint64_t getMessageId() const { return messageId; }
+  uint32_t getCreateCount() const { return createCount; }
+  uint32_t getEditCount() const { return editCount; }
+  uint32_t getSkippedCount() const { return skippedCount; }
+};
+
+// Global instance
+extern LiveStatus liveStatus;
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LOCAL_CONTROL_SERVER_H
+#define LOCAL_CONTROL_SERVER_H
+
+#include <WiFiUdp.h>
+#include <Arduino.h>
+#include "LatencyStats.h"
+
+// UDP endpoint that runs commands from the LAN without a Discord round trip.
+// Each datagram is one command ("<key> color #ff8800"); every reply the
+// command produces is sent back to the caller as the same JSON payload that
+// would have been posted to Discord, including replies from async jobs that
+// finish after the datagram was handled.
+class LocalControlServer {
+private:
+  static const size_t MAX_PACKET_SIZE = 256;
+  static const int MAX_PACKETS_PER_UPDATE = 4;
+  
+  WiFiUDP udp;
+  char packet[MAX_PACKET_SIZE];
+  IPAddress callerIp;
+  uint16_t callerPort;
+  uint32_t commandStartUs;
+  bool running;
+  LatencyStats commandLatency;
+  
+  void handlePacket(size_t length);
+  static bool replyToCaller(const char* payload, size_t length, uint64_t caller);
+  
+public:
+  LocalControlServer();
+  
+  // Core functions
+  void begin(uint16_t port);
+  void update();
+  
+  // Getters
+  bool isRunning() const { return running; }
+  const LatencyStats& getCommandLatency() const { return commandLatency; }
+};
+
+// Global instance
+extern LocalControlServer localControlServer;
+
+#endif
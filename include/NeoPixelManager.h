@@ -16,6 +16,15 @@ private:
   unsigned long rainbowStep;
   bool rainbowMode;
   bool enabled;
+  uint32_t color; // Last static color, restored after a flash
+  
+  // Flash in progress (ended from update())
+  bool flashing;
+  bool flashWasRainbow;
+  unsigned long flashEndMs;
+  uint16_t flashId; // Identifies the running flash to cancelFlash()
+  
+  void endFlash();
   
 public:
   NeoPixelManager();
@@ -28,11 +37,16 @@ public:
   void setColor(uint8_t red, uint8_t green, uint8_t blue);
   void setRainbowMode(bool enable);
   void setEnabled(bool enable);
-  void flashColor(uint8_t red, uint8_t green, uint8_t blue, int duration = 500);
+  void setBrightness(uint8_t brightness);
+  // Returns immediately with an id for cancelFlash()
+  uint16_t flashColor(uint8_t red, uint8_t green, uint8_t blue, int duration = 500);
+  // Ends the flash only if it is still the one with this id
+  void cancelFlash(uint16_t id);
   
   // Getters
   bool isEnabled() const { return enabled; }
   bool isRainbowMode() const { return rainbowMode; }
+  bool isFlashing() const { return flashing; }
   
   // Predefined colors
   void setRed() { setColor(255, 0, 0); }
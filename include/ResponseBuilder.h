@@ -0,0 +1,62 @@
+#ifndef RESPONSE_BUILDER_H
+#define RESPONSE_BUILDER_H
+
+#include <Arduino.h>
+
+// Precomputed JSON payload for a reply known at compile time. The text must
+// already be JSON-safe: write newlines as \\n and avoid quotes/backslashes.
+#define STATIC_REPLY(text) "{\"content\":\"" text "\"}"
+
+// Builds Discord message payloads directly into a preallocated buffer,
+// escaping text inline. Content must be written before any embeds. When the
+// buffer fills up the text is truncated but the payload stays valid JSON.
+class ResponseBuilder {
+public:
+  static const size_t BUFFER_SIZE = 2048;
+
+  ResponseBuilder();
+
+  ResponseBuilder& begin();
+
+  // Message content (appends to the content string if already started)
+  ResponseBuilder& content(const char* text);
+  ResponseBuilder& contentf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+  // Embeds
+  ResponseBuilder& beginEmbed(const char* title, uint32_t color);
+  ResponseBuilder& embedDescription(const char* text);
+  ResponseBuilder& field(const char* name, const char* value, bool inlineField = false);
+  ResponseBuilder& endEmbed();
+
+  // Closes all open structures and returns the NUL-terminated payload
+  const char* finish();
+
+  const char* data() const { return buffer; }
+  size_t length() const { return used; }
+  bool isTruncated() const { return overflow; }
+
+private:
+  static const uint8_t MAX_DEPTH = 6;
+  // Room always kept free for the closing characters and the terminator
+  static const size_t CLOSING_RESERVE = MAX_DEPTH + 1;
+
+  char buffer[BUFFER_SIZE];
+  size_t used;
+  char closers[MAX_DEPTH];
+  uint8_t depth;
+  uint8_t rootMembers;
+  uint8_t embedCount;
+  uint8_t fieldCount;
+  bool contentOpen;
+  bool embedsOpen;
+  bool overflow;
+
+  bool raw(const char* text);
+  bool open(const char* text, char closer);
+  void close();
+  void closeTo(uint8_t targetDepth);
+  void escaped(const char* text);
+  void stringValue(const char* keyPrefix, const char* text);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SEND_BACKEND_H
+#define SEND_BACKEND_H
+
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <Arduino.h>
+
+// One Discord rate-limit bucket, tracked from X-RateLimit-* response headers
+struct RateLimitBucket {
+  int16_t remaining; // -1 until the first response
+  unsigned long resetAtMs;
+  uint32_t requestCount;
+  uint32_t limitedCount; // 429 responses
+  uint32_t deferredCount; // Sends refused while the bucket was empty
+};
+
+// Where outbound messages go. Each backend has its own rate-limit bucket,
+// so moving a channel to another backend moves it to another budget.
+// Sends never wait for a bucket: they run inside the WebSocket callback, so
+// an empty bucket fails fast with RATE_LIMITED and the caller retries later.
+class SendBackend {
+public:
+  // Returned instead of an HTTP status when the bucket is empty
+  static const int RATE_LIMITED = -100;
+  
+  explicit SendBackend(const char* name);
+  virtual ~SendBackend() {}
+  
+  // Posts a message; pass body to wait for and receive the created message
+  virtual int post(const char* payload, size_t length, String* body = nullptr) = 0;
+  // Edits a message this backend posted
+  virtual int edit(uint64_t messageId, const char* payload, size_t length) = 0;
+  virtual bool isConfigured() const = 0;
+  
+  // False while the bucket is empty and has not reset yet
+  bool isReady() const;
+  
+  // Getters
+  const char* getName() const { return name; }
+  const RateLimitBucket& getBucket() const { return bucket; }
+  
+protected:
+  WiFiClient* client;
+  
+  // HTTP status, or a negative HTTPClient error
+  int request(const char* method, const String& url, const char* authorization,
+              const char* payload, size_t length, String* body);
+  
+private:
+  const char* name;
+  RateLimitBucket bucket;
+  
+  void updateBucket(HTTPClient& http, int httpCode);
+};
+
+// Bot REST API: POST /channels/{id}/messages with the bot token
+class BotSendBackend : public SendBackend {
+private:
+  String messagesUrl;
+  String authorizationHeader;
+  
+public:
+  BotSendBackend() : SendBackend("bot") {}
+  
+  void begin(WiFiClient& client, const String& messagesUrl, const String& authorizationHeader);
+  int post(const char* payload, size_t length, String* body = nullptr) override;
+  int edit(uint64_t messageId, const char* payload, size_t length) override;
+  bool isConfigured() const override { return messagesUrl.length() > 0; }
+};
+
+// Channel webhook: no auth header and a rate limit separate from the bot's.
+// Without wait the reply is fire-and-forget (204, no message body).
+class WebhookSendBackend : public SendBackend {
+private:
+  // Built once in begin(); the configured URL may carry a query (?thread_id=)
+  String postUrl;
+  String waitPostUrl;
+  String messagesUrl;  // .../messages/, followed by the id and messagesQuery
+  String messagesQuery;
+  bool wait;
+  
+public:
+  WebhookSendBackend() : SendBackend("webhook"), wait(false) {}
+  
+  void begin(WiFiClient& client, const String& webhookUrl, bool wait);
+  int post(const char* payload, size_t length, String* body = nullptr) override;
+  int edit(uint64_t messageId, const char* payload, size_t length) override;
+  bool isConfigured() const override { return postUrl.length() > 0; }
+};
+
+#endif
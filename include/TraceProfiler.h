@@ -0,0 +1,101 @@
+#ifndef TRACE_PROFILER_H
+#define TRACE_PROFILER_H
+
+#include <Arduino.h>
+
+// Build with -DTRACE_ENABLED=0 to compile all trace scopes out
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Default stall threshold, adjustable at runtime with the `trace` command
+#ifndef TRACE_STALL_THRESHOLD_MS
+#define TRACE_STALL_THRESHOLD_MS 100
+#endif
+
+// Completed scope (names must be string literals or otherwise long-lived)
+struct TraceEvent {
+  const char* name;
+  uint32_t startUs;
+  uint32_t durationUs;
+  uint8_t depth;
+  bool stall;
+};
+
+// Records completed scopes into a ring buffer. Scopes over the stall
+// threshold are also kept in a small buffer of their own, since the ring
+// only covers the last few seconds. Export is incremental from update(), and
+// both buffers are frozen until it finishes.
+class TraceProfiler {
+private:
+  static const int MAX_EVENTS = 256;
+  static const int MAX_STALL_EVENTS = 32;
+  static const uint8_t MAX_DEPTH = 31;
+  // Serial TX space wanted before writing another event during export
+  static const int EXPORT_EVENT_BYTES = 192;
+  
+  TraceEvent events[MAX_EVENTS];
+  int head;
+  int count;
+  TraceEvent stallEvents[MAX_STALL_EVENTS];
+  int stallHead;
+  int stallEventCount;
+  Print* exportOut; // Non-null while an export is in progress
+  int exportIndex;
+  uint8_t depth;
+  uint32_t stalledChildren; // Bit n set: a scope nested at depth n+1 already stalled
+  uint32_t stallThresholdUs;
+  uint32_t stallCount;
+  const char* lastStallName;
+  uint32_t lastStallUs;
+  
+  const TraceEvent& exportEvent(int index) const;
+  
+public:
+  TraceProfiler();
+  
+  // Scope bookkeeping (use TRACE_SCOPE rather than calling these)
+  uint8_t enter();
+  void exit(const char* name, uint32_t startUs, uint8_t scopeDepth);
+  
+  // Configuration
+  void setStallThreshold(uint32_t thresholdMs) { stallThresholdUs = thresholdMs * 1000UL; }
+  uint32_t getStallThreshold() const { return stallThresholdUs / 1000UL; }
+  
+  // Export as Chrome/Perfetto trace-event JSON, a few events per update()
+  bool startExport(Print& out);
+  void update();
+  bool isExporting() const { return exportOut != nullptr; }
+  
+  // Getters
+  int getEventCount() const { return count; }
+  int getStallEventCount() const { return stallEventCount; }
+  uint32_t getStallCount() const { return stallCount; }
+  const char* getLastStallName() const { return lastStallName; }
+  uint32_t getLastStallMs() const { return lastStallUs / 1000UL; }
+};
+
+// RAII scope recorded into the ring buffer when it ends
+class TraceScope {
+private:
+  const char* name;
+  uint32_t startUs;
+  uint8_t depth;
+  
+public:
+  explicit TraceScope(const char* scopeName);
+  ~TraceScope();
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
+
+// Global instance
+extern TraceProfiler traceProfiler;
+
+#endif
@@ -2,11 +2,65 @@
 #include "DiscordClient.h"
 #include "NeoPixelManager.h"
 #include "SystemManager.h"
+#include "TraceProfiler.h"
+#include "LocalControlServer.h"
+#include "GuildCache.h"
+#include "JobScheduler.h"
+#include "CommandThrottle.h"
+#include "LiveStatus.h"
+#include <strings.h>
 
 // Global instance
 CommandSystem commandSystem;
 
-CommandSystem::CommandSystem() : commandCount(0) {}
+// Bytes of user input echoed back in error replies
+static const size_t MAX_ECHO_BYTES = 32;
+
+// Echo length clamped to MAX_ECHO_BYTES without splitting a UTF-8 sequence
+static int echoLength(const StringView& token) {
+  size_t length = token.length;
+  if (length > MAX_ECHO_BYTES) {
+    length = MAX_ECHO_BYTES;
+    while (length > 0 && (token.data[length] & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+  return (int)length;
+}
+
+// Named colors accepted by ARG_COLOR in addition to #rrggbb
+struct NamedColor {
+  const char* name;
+  uint32_t rgb;
+};
+
+static const NamedColor NAMED_COLORS[] = {
+  {"red", 0xFF0000},
+  {"green", 0x00FF00},
+  {"blue", 0x0000FF},
+  {"white", 0xFFFFFF},
+  {"yellow", 0xFFFF00},
+  {"cyan", 0x00FFFF},
+  {"magenta", 0xFF00FF},
+  {"orange", 0xFF8800},
+  {"purple", 0x8000FF},
+};
+
+// Simulated power button hold; real hardware would drive a relay here
+static const unsigned long POWER_PRESS_MS = 500;
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool StringView::equalsIgnoreCase(const char* other) const {
+  return strlen(other) == length && strncasecmp(other, data, length) == 0;
+}
+
+CommandSystem::CommandSystem() : commandCount(0), helpPayload(nullptr), helpPayloadLength(0), staticRepliesDirty(true) {}
 
 bool CommandSystem::addCommand(const String& name, const String& description, CommandCallback callback) {
   if (commandCount >= MAX_COMMANDS) {
@@ -14,120 +68,580 @@ bool CommandSystem::addCommand(const String& name, const String& description, Co
     return false;
   }
   
-  commands[commandCount] = {name, description, callback};
+  commands[commandCount] = {name, description, callback, nullptr, nullptr, 0, 1};
   commandCount++;
+  staticRepliesDirty = true;
   Serial.println("Command registered: " + name);
   return true;
 }
 
-void CommandSystem::executeCommand(const String& command) {
-  String cmd = command;
-  cmd.toLowerCase();
-  cmd.trim();
+bool CommandSystem::addCommand(const String& name, const String& description, const ArgSpec* args, uint8_t argCount, ArgsCommandCallback callback) {
+  if (commandCount >= MAX_COMMANDS) {
+    Serial.println("Error: Maximum number of commands reached");
+    return false;
+  }
+  if (argCount > CommandArgs::MAX_ARGS) {
+    Serial.println("Error: Too many arguments for command " + name);
+    return false;
+  }
+  
+  commands[commandCount] = {name, description, nullptr, callback, args, argCount, 1};
+  commandCount++;
+  staticRepliesDirty = true;
+  Serial.println("Command registered: " + name);
+  return true;
+}
+
+bool CommandSystem::setCommandCost(const char* name, uint8_t cost) {
+  for (int i = 0; i < commandCount; i++) {
+    if (commands[i].name.equalsIgnoreCase(name)) {
+      commands[i].cost = cost;
+      return true;
+    }
+  }
+  Serial.printf("Error: Cannot set cost of unknown command %s\n", name);
+  return false;
+}
+
+uint8_t CommandSystem::getCommandCost(const char* command, size_t length) const {
+  StringView name;
+  if (!nextCommandName(command, command + length, name)) {
+    return 0;
+  }
+  
+  // Unknown commands still cost a token since they are answered too
+  const Command* entry = findCommand(name);
+  return entry ? entry->cost : 1;
+}
+
+const Command* CommandSystem::findCommand(const StringView& name) const {
+  for (int i = 0; i < commandCount; i++) {
+    if (name.equalsIgnoreCase(commands[i].name.c_str())) {
+      return &commands[i];
+    }
+  }
+  return nullptr;
+}
+
+bool CommandSystem::nextCommandName(const char*& cursor, const char* end, StringView& name) {
+  if (!nextToken(cursor, end, name)) {
+    return false;
+  }
   
   // Remove leading slash if present
-  if (cmd.startsWith("/")) {
-    cmd = cmd.substring(1);
+  if (name.data[0] == '/') {
+    name.data++;
+    name.length--;
+  }
+  return name.length > 0;
+}
+
+bool CommandSystem::nextToken(const char*& cursor, const char* end, StringView& token) {
+  while (cursor < end && isspace((unsigned char)*cursor)) {
+    cursor++;
+  }
+  if (cursor >= end) {
+    return false;
+  }
+  
+  token.data = cursor;
+  while (cursor < end && !isspace((unsigned char)*cursor)) {
+    cursor++;
+  }
+  token.length = cursor - token.data;
+  return true;
+}
+
+bool CommandSystem::parseArg(const ArgSpec& spec, const StringView& token, int32_t& value) {
+  switch (spec.type) {
+    case ARG_INT:
+    case ARG_DURATION: {
+      size_t i = 0;
+      bool negative = spec.type == ARG_INT && token.length > 1 && token.data[0] == '-';
+      if (negative) i++;
+      
+      int64_t number = 0;
+      size_t digitsStart = i;
+      while (i < token.length && isdigit((unsigned char)token.data[i])) {
+        number = number * 10 + (token.data[i] - '0');
+        if (number > INT32_MAX) return false;
+        i++;
+      }
+      if (i == digitsStart) return false;
+      
+      if (spec.type == ARG_DURATION) {
+        StringView suffix = {token.data + i, token.length - i};
+        if (suffix.length == 0 || suffix.equalsIgnoreCase("ms")) {
+          // Already milliseconds
+        } else if (suffix.equalsIgnoreCase("s")) {
+          number *= 1000;
+        } else if (suffix.equalsIgnoreCase("m")) {
+          number *= 60000;
+        } else {
+          return false;
+        }
+      } else if (i != token.length) {
+        return false;
+      }
+      
+      if (negative) number = -number;
+      if (number < spec.min || number > spec.max) return false;
+      value = (int32_t)number;
+      return true;
+    }
+      
+    case ARG_COLOR: {
+      if (token.length == 7 && token.data[0] == '#') {
+        uint32_t rgb = 0;
+        for (size_t i = 1; i < 7; i++) {
+          int digit = hexDigit(token.data[i]);
+          if (digit < 0) return false;
+          rgb = (rgb << 4) | digit;
+        }
+        value = (int32_t)rgb;
+        return true;
+      }
+      for (const NamedColor& color : NAMED_COLORS) {
+        if (token.equalsIgnoreCase(color.name)) {
+          value = (int32_t)color.rgb;
+          return true;
+        }
+      }
+      return false;
+    }
+      
+    case ARG_ENUM:
+      for (int32_t i = 0; spec.choices && spec.choices[i]; i++) {
+        if (token.equalsIgnoreCase(spec.choices[i])) {
+          value = i;
+          return true;
+        }
+      }
+      return false;
+  }
+  return false;
+}
+
+void CommandSystem::describeArg(const ArgSpec& spec, char* buffer, size_t size) {
+  switch (spec.type) {
+    case ARG_INT:
+      snprintf(buffer, size, "an integer from %ld to %ld", (long)spec.min, (long)spec.max);
+      break;
+    case ARG_COLOR:
+      snprintf(buffer, size, "a hex color like `#ff8800` or a color name");
+      break;
+    case ARG_DURATION:
+      snprintf(buffer, size, "a duration from %ldms to %ldms like `200ms` or `2s`", (long)spec.min, (long)spec.max);
+      break;
+    case ARG_ENUM: {
+      size_t used = snprintf(buffer, size, "one of:");
+      for (int i = 0; spec.choices && spec.choices[i] && used < size; i++) {
+        used += snprintf(buffer + used, size - used, " `%s`", spec.choices[i]);
+      }
+      break;
+    }
+  }
+}
+
+void CommandSystem::formatUsage(const Command& command, char* buffer, size_t size) {
+  size_t used = snprintf(buffer, size, "%s", command.name.c_str());
+  for (uint8_t i = 0; i < command.argCount && used < size; i++) {
+    const ArgSpec& spec = command.args[i];
+    bool opensGroup = i + 1 < command.argCount && command.args[i + 1].withPrevious;
+    const char* format = spec.withPrevious ? " <%s>]" : opensGroup ? " [%s" : spec.optional ? " [%s]" : " <%s>";
+    used += snprintf(buffer + used, size - used, format, spec.name);
   }
+}
+
+bool CommandSystem::parseArgs(const Command& command, const char* cursor, const char* end, CommandArgs& args) const {
+  char usage[64];
+  char expected[96];
+  StringView token;
   
-  if (cmd.length() == 0) {
+  args.argCount = 0;
+  while (nextToken(cursor, end, token)) {
+    if (args.argCount >= command.argCount) {
+      formatUsage(command, usage, sizeof(usage));
+      discordClient.beginResponse().contentf("❌ Too many arguments for `%s`. Usage: `%s`", command.name.c_str(), usage);
+      discordClient.sendResponse();
+      return false;
+    }
+    
+    const ArgSpec& spec = command.args[args.argCount];
+    if (!parseArg(spec, token, args.values[args.argCount])) {
+      formatUsage(command, usage, sizeof(usage));
+      describeArg(spec, expected, sizeof(expected));
+      discordClient.beginResponse().contentf("❌ Invalid value `%.*s` for `<%s>`: expected %s. Usage: `%s`",
+                                             echoLength(token), token.data, spec.name, expected, usage);
+      discordClient.sendResponse();
+      return false;
+    }
+    args.argCount++;
+  }
+  
+  const ArgSpec* missing = args.argCount < command.argCount ? &command.args[args.argCount] : nullptr;
+  if (missing && (!missing->optional || (missing->withPrevious && args.argCount > 0))) {
+    formatUsage(command, usage, sizeof(usage));
+    discordClient.beginResponse().contentf("❌ Missing argument `<%s>` for `%s`. Usage: `%s`",
+                                           missing->name, command.name.c_str(), usage);
+    discordClient.sendResponse();
+    return false;
+  }
+  return true;
+}
+
+void CommandSystem::executeCommand(const char* command, size_t length) {
+  const char* cursor = command;
+  const char* end = command + length;
+  
+  StringView name;
+  if (!nextCommandName(cursor, end, name)) {
     return;
   }
   
-  Serial.println("Executing command: " + cmd);
+  Serial.printf("Executing command: %.*s\n", (int)name.length, name.data);
   
   // Search for command in command table
-  bool commandFound = false;
-  for (int i = 0; i < commandCount; i++) {
-    if (commands[i].name.equals(cmd)) {
-      Serial.println("Command found: " + commands[i].name);
-      commands[i].callback();
-      commandFound = true;
-      break;
+  const Command* entry = findCommand(name);
+  if (entry) {
+    Serial.printf("Command found: %s\n", entry->name.c_str());
+    CommandArgs args;
+    if (parseArgs(*entry, cursor, end, args)) {
+      TRACE_SCOPE(entry->name.c_str());
+      if (entry->argsCallback) {
+        entry->argsCallback(args);
+      } else {
+        entry->callback();
+      }
     }
+    return;
   }
   
-  if (!commandFound) {
-    Serial.println("Unknown command: " + cmd);
-    discordClient.sendMessage("❌ Unknown command: `" + cmd + "`. Type `help` to see available commands.");
-  }
+  Serial.printf("Unknown command: %.*s\n", (int)name.length, name.data);
+  discordClient.beginResponse().contentf("❌ Unknown command: `%.*s`. Type `help` to see available commands.",
+                                         echoLength(name), name.data);
+  discordClient.sendResponse();
 }
 
-String CommandSystem::getHelpText() const {
-  String helpText = "🤖 **Available Commands:**\n\n";
+void CommandSystem::buildStaticReplies() {
+  // Built once after registration; help replies reuse the cached payload
+  ResponseBuilder& builder = discordClient.beginResponse();
+  char usage[64];
   
+  builder.content("🤖 **Available Commands:**\n\n");
   for (int i = 0; i < commandCount; i++) {
-    helpText += "`" + commands[i].name + "` - " + commands[i].description + "\n";
+    formatUsage(commands[i], usage, sizeof(usage));
+    builder.content("`").content(usage).content("` - ").content(commands[i].description.c_str()).content("\n");
   }
   
-  helpText += "\n💡 **Tips:**\n";
-  helpText += "• Commands are case-insensitive\n";
-  helpText += "• You can use commands with or without `/`\n";
-  helpText += "• LED starts in rainbow mode by default";
+  builder.content("\n💡 **Tips:**\n");
+  builder.content("• Commands are case-insensitive\n");
+  builder.content("• You can use commands with or without `/`\n");
+  builder.content("• Colors can be names or hex like `#ff8800`, durations like `200ms` or `2s`\n");
+  builder.content("• LED starts in rainbow mode by default");
+  builder.finish();
   
-  return helpText;
+  free(helpPayload);
+  helpPayloadLength = builder.length();
+  helpPayload = (char*)malloc(helpPayloadLength + 1);
+  if (helpPayload) {
+    memcpy(helpPayload, builder.data(), helpPayloadLength + 1);
+  }
+  staticRepliesDirty = false;
+  Serial.println("Static replies built, help payload: " + String(helpPayloadLength) + " bytes");
 }
 
 // Command implementations
 void CommandSystem::statusCommand() {
-  String status = "✅ **System Status:**\n";
-  status += "🖥️ PC: " + String(systemManager.isOnline() ? "Online" : "Offline") + "\n";
-  status += "💡 LED: " + String(neoPixelManager.isEnabled() ? "Enabled" : "Disabled") + "\n";
-  status += "🌈 Mode: " + String(neoPixelManager.isRainbowMode() ? "Rainbow" : "Static") + "\n";
-  status += "🔗 WebSocket: " + String(discordClient.isWebSocketConnected() ? "Connected" : "Disconnected");
+  writeStatusEmbed(discordClient.beginResponse(), "✅ System Status", true);
+  discordClient.sendResponse();
+}
+
+void CommandSystem::writeStatusEmbed(ResponseBuilder& reply, const char* title, bool counters) {
+  // The live status message is edited whenever its output changes, so it
+  // leaves out counters that tick during floods and guild churn
+  reply.beginEmbed(title, 0x2ECC71);
+  reply.field("🖥️ PC", systemManager.isOnline() ? "Online" : "Offline", true);
+  reply.field("💡 LED", neoPixelManager.isEnabled() ? "Enabled" : "Disabled", true);
+  reply.field("🌈 Mode", neoPixelManager.isRainbowMode() ? "Rainbow" : "Static", true);
+  reply.field("🔗 WebSocket", discordClient.isWebSocketConnected() ? "Connected" : "Disconnected", true);
+  char shard[16];
+  snprintf(shard, sizeof(shard), "%u/%u", discordClient.getShardId(), discordClient.getShardCount());
+  reply.field("🧩 Shard", shard, true);
+  if (counters) {
+    char cache[48];
+    snprintf(cache, sizeof(cache), "%u guilds, %u channels, %u roles",
+             guildCache.getGuildCount(), guildCache.getChannelCount(), guildCache.getRoleCount());
+    reply.field("🗂️ Cache", cache, true);
+    char throttled[24];
+    snprintf(throttled, sizeof(throttled), "%lu dropped", (unsigned long)commandThrottle.getDroppedCount());
+    reply.field("🐢 Throttled", throttled, true);
+  }
+  reply.field("📤 Replies", discordClient.getSendBackend().getName(), true);
+  reply.endEmbed();
+}
+
+// Flash started by the running power job (only one runs at a time)
+static uint16_t powerFlashId = 0;
+
+// Power sequences run as jobs: press the button, report once it is released
+static JobStatus powerStep(Job& job) {
+  bool turnOn = job.arg;
+  if (job.state == 0) {
+    powerFlashId = neoPixelManager.flashColor(turnOn ? 0 : 255, turnOn ? 255 : 0, 0, POWER_PRESS_MS); // Green or red
+    job.state = 1;
+    job.progress = 50;
+    job.sleep(POWER_PRESS_MS);
+    return JOB_RUNNING;
+  }
+  
+  job.progress = 100;
+  return JOB_DONE;
+}
+
+static void powerFinish(Job& job, JobStatus status) {
+  bool turnOn = job.arg;
+  uint16_t flashId = powerFlashId;
+  powerFlashId = 0;
+  if (status == JOB_DONE) {
+    discordClient.sendStaticReply(turnOn
+      ? STATIC_REPLY("🔌 **PC Turn On Command Executed**\\n*Note: This is a simulation. Connect actual hardware for real control.*")
+      : STATIC_REPLY("🔴 **PC Turn Off Command Executed**\\n*Note: This is a simulation. Connect actual hardware for real control.*"));
+    return;
+  }
   
-  discordClient.sendMessage(status);
+  // A `flash` issued since then owns the LED and keeps running
+  neoPixelManager.cancelFlash(flashId);
+  discordClient.beginResponse().contentf("⛔ **PC Turn %s %s** (job #%u)", turnOn ? "On" : "Off",
+                                         status == JOB_CANCELLED ? "cancelled" : "failed", job.id);
+  discordClient.sendResponse();
+}
+
+static void startPowerJob(bool turnOn) {
+  // Only one power sequence at a time
+  const Job* running = jobScheduler.findByName("turn_on");
+  if (!running) {
+    running = jobScheduler.findByName("turn_off");
+  }
+  if (running) {
+    discordClient.beginResponse().contentf("⏳ **Power sequence already running** (job #%u `%s`). Use `cancel %u` to stop it.",
+                                           running->id, running->name, running->id);
+    discordClient.sendResponse();
+    return;
+  }
+  
+  uint16_t id = jobScheduler.start(turnOn ? "turn_on" : "turn_off", powerStep, powerFinish, turnOn);
+  if (id) {
+    discordClient.beginResponse().contentf("%s **PC Turn %s started** (job #%u)", turnOn ? "🔌" : "🔴", turnOn ? "On" : "Off", id);
+    discordClient.sendResponse();
+  }
 }
 
 void CommandSystem::turnOnCommand() {
-  discordClient.sendMessage("🔌 **PC Turn On Command Executed**\n*Note: This is a simulation. Connect actual hardware for real control.*");
-  neoPixelManager.flashColor(0, 255, 0); // Flash green
+  startPowerJob(true);
 }
 
 void CommandSystem::turnOffCommand() {
-  discordClient.sendMessage("🔴 **PC Turn Off Command Executed**\n*Note: This is a simulation. Connect actual hardware for real control.*");
-  neoPixelManager.flashColor(255, 0, 0); // Flash red
+  startPowerJob(false);
 }
 
 void CommandSystem::rainbowCommand() {
   neoPixelManager.setRainbowMode(true);
   neoPixelManager.setEnabled(true);
-  discordClient.sendMessage("🌈 **Rainbow mode enabled!**");
+  discordClient.sendStaticReply(STATIC_REPLY("🌈 **Rainbow mode enabled!**"));
   Serial.println("Rainbow mode activated");
 }
 
 void CommandSystem::redCommand() {
   neoPixelManager.setRed();
-  discordClient.sendMessage("🔴 **LED set to red**");
+  discordClient.sendStaticReply(STATIC_REPLY("🔴 **LED set to red**"));
   Serial.println("LED set to red");
 }
 
 void CommandSystem::greenCommand() {
   neoPixelManager.setGreen();
-  discordClient.sendMessage("🟢 **LED set to green**");
+  discordClient.sendStaticReply(STATIC_REPLY("🟢 **LED set to green**"));
   Serial.println("LED set to green");
 }
 
 void CommandSystem::blueCommand() {
   neoPixelManager.setBlue();
-  discordClient.sendMessage("🔵 **LED set to blue**");
+  discordClient.sendStaticReply(STATIC_REPLY("🔵 **LED set to blue**"));
   Serial.println("LED set to blue");
 }
 
 void CommandSystem::whiteCommand() {
   neoPixelManager.setWhite();
-  discordClient.sendMessage("⚪ **LED set to white**");
+  discordClient.sendStaticReply(STATIC_REPLY("⚪ **LED set to white**"));
   Serial.println("LED set to white");
 }
 
 void CommandSystem::offCommand() {
   neoPixelManager.turnOff();
-  discordClient.sendMessage("⚫ **LED turned off**");
+  discordClient.sendStaticReply(STATIC_REPLY("⚫ **LED turned off**"));
   Serial.println("LED turned off");
 }
 
 void CommandSystem::helpCommand() {
-  String helpText = commandSystem.getHelpText();
-  discordClient.sendMessage(helpText);
+  if (commandSystem.staticRepliesDirty) {
+    commandSystem.buildStaticReplies();
+  }
+  if (commandSystem.helpPayload) {
+    discordClient.sendPayload(commandSystem.helpPayload, commandSystem.helpPayloadLength);
+  }
   Serial.println("Help command executed");
 }
+
+void CommandSystem::latencyCommand() {
+  const LatencyStats& lan = localControlServer.getCommandLatency();
+  const LatencyStats& discord = discordClient.getCommandLatency();
+  
+  ResponseBuilder& reply = discordClient.beginResponse();
+  reply.beginEmbed("⏱️ Command Latency", 0x3498DB);
+  reply.embedDescription("LAN: datagram received → reply sent.\nDiscord: message created → reply posted (needs NTP).");
+  
+  char value[64];
+  snprintf(value, sizeof(value), "%lu commands\navg %lu µs, max %lu µs", (unsigned long)lan.count,
+           (unsigned long)lan.averageUs(), (unsigned long)lan.maxUs);
+  reply.field("🏠 LAN", localControlServer.isRunning() ? value : "Disabled", true);
+  snprintf(value, sizeof(value), "%lu commands\navg %lu ms, max %lu ms", (unsigned long)discord.count,
+           (unsigned long)(discord.averageUs() / 1000), (unsigned long)(discord.maxUs / 1000));
+  reply.field("☁️ Discord", value, true);
+  reply.endEmbed();
+  discordClient.sendResponse();
+}
+
+void CommandSystem::colorCommand(const CommandArgs& args) {
+  uint32_t rgb = args.getColor(0);
+  neoPixelManager.setColor((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+  
+  discordClient.beginResponse().contentf("🎨 **LED set to #%06lx**", (unsigned long)rgb);
+  discordClient.sendResponse();
+  Serial.printf("LED set to #%06lx\n", (unsigned long)rgb);
+}
+
+void CommandSystem::brightnessCommand(const CommandArgs& args) {
+  uint8_t level = (uint8_t)args.getInt(0);
+  neoPixelManager.setBrightness(level);
+  
+  discordClient.beginResponse().contentf("🔆 **Brightness set to %u**", level);
+  discordClient.sendResponse();
+  Serial.printf("Brightness set to %u\n", level);
+}
+
+void CommandSystem::flashCommand(const CommandArgs& args) {
+  uint32_t rgb = args.getColor(0);
+  uint32_t duration = args.getDuration(1, 500);
+  
+  discordClient.beginResponse().contentf("⚡ **Flashing #%06lx for %lums**", (unsigned long)rgb, (unsigned long)duration);
+  discordClient.sendResponse();
+  neoPixelManager.flashColor((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, duration);
+}
+
+void CommandSystem::traceCommand(const CommandArgs& args) {
+  if (args.has(0)) {
+    traceProfiler.setStallThreshold(args.getInt(0));
+  }
+  
+  // The dump is written from the main loop, not from this gateway callback
+  ResponseBuilder& reply = discordClient.beginResponse();
+  if (traceProfiler.startExport(Serial)) {
+    reply.contentf("📈 **Trace export started on serial** (%d events, %d stalled scopes)",
+                   traceProfiler.getEventCount(), traceProfiler.getStallEventCount());
+  } else {
+    reply.content("📈 **Trace export already in progress**");
+  }
+  reply.contentf("\nStall threshold: %lu ms, stalls: %lu", (unsigned long)traceProfiler.getStallThreshold(),
+                 (unsigned long)traceProfiler.getStallCount());
+  if (traceProfiler.getLastStallName()) {
+    reply.contentf("\nLast stall: `%s` (%lu ms)", traceProfiler.getLastStallName(),
+                   (unsigned long)traceProfiler.getLastStallMs());
+  }
+  discordClient.sendResponse();
+}
+
+void CommandSystem::shardCommand(const CommandArgs& args) {
+  ResponseBuilder& reply = discordClient.beginResponse();
+  
+  if (!args.has(0)) {
+    reply.contentf("🧩 **Shard %u of %u** (max_concurrency %u)", discordClient.getShardId(),
+                   discordClient.getShardCount(), discordClient.getMaxConcurrency());
+  } else if (discordClient.saveShardConfig(args.getInt(0), args.getInt(1))) {
+    reply.contentf("🧩 **Shard set to %ld of %ld**\nRestart the board to apply.", (long)args.getInt(0), (long)args.getInt(1));
+  } else {
+    reply.content("❌ Shard id must be lower than the shard count");
+  }
+  discordClient.sendResponse();
+}
+
+void CommandSystem::cancelCommand(const CommandArgs& args) {
+  if (!args.has(0)) {
+    ResponseBuilder& reply = discordClient.beginResponse();
+    if (jobScheduler.getActiveCount() == 0) {
+      reply.content("💤 **No jobs running**");
+    } else {
+      reply.content("⚙️ **Running jobs:**");
+      for (uint8_t i = 0; i < JobScheduler::MAX_JOBS; i++) {
+        const Job* job = jobScheduler.getSlot(i);
+        if (job) {
+          reply.contentf("\n`#%u` %s - %u%%, %lus", job->id, job->name, job->progress,
+                         (unsigned long)((millis() - job->startedMs) / 1000));
+        }
+      }
+      reply.content("\nUse `cancel <job>` to stop one.");
+    }
+    discordClient.sendResponse();
+    return;
+  }
+  
+  uint16_t id = args.getInt(0);
+  const Job* job = jobScheduler.find(id);
+  if (!job) {
+    discordClient.beginResponse().contentf("❌ No running job #%u", id);
+    discordClient.sendResponse();
+    return;
+  }
+  
+  // The job reports its cancellation to whoever started it; answer here only if that was someone else
+  bool startedHere = job->route == discordClient.getReplyRoute();
+  jobScheduler.cancel(id);
+  if (!startedHere) {
+    discordClient.beginResponse().contentf("⛔ **Cancelled job #%u**", id);
+    discordClient.sendResponse();
+  }
+}
+
+void CommandSystem::sendViaCommand(const CommandArgs& args) {
+  ResponseBuilder& reply = discordClient.beginResponse();
+  if (args.has(0) && !discordClient.setSendBackend(args.getInt(0) == 1)) { // Choices: bot, webhook
+    reply.content("❌ No webhook configured. Set `DISCORD_WEBHOOK_URL` in config.cpp.\n");
+  }
+  
+  reply.contentf("📤 **Replies via %s**", discordClient.getSendBackend().getName());
+  const SendBackend* backends[] = {&discordClient.getBotBackend(), &discordClient.getWebhookBackend()};
+  for (const SendBackend* backend : backends) {
+    const RateLimitBucket& bucket = backend->getBucket();
+    reply.contentf("\n`%s`: %lu requests, %lu rate limited, %lu deferred", backend->getName(),
+                   (unsigned long)bucket.requestCount, (unsigned long)bucket.limitedCount,
+                   (unsigned long)bucket.deferredCount);
+  }
+  discordClient.sendResponse();
+}
+
+void CommandSystem::liveStatusCommand(const CommandArgs& args) {
+  if (args.has(0)) {
+    liveStatus.setEnabled(args.getInt(0) == 0); // Choices: on, off
+  }
+  
+  ResponseBuilder& reply = discordClient.beginResponse();
+  if (!liveStatus.isEnabled()) {
+    reply.content("📡 **Live status is off**");
+  } else if (liveStatus.getMessageId() == 0) {
+    reply.content("📡 **Live status is on**\nThe status message will be posted shortly.");
+  } else {
+    reply.contentf("📡 **Live status is on** (message %llu)\n%lu edits, %lu posts, %lu unchanged checks",
+                   (unsigned long long)liveStatus.getMessageId(), (unsigned long)liveStatus.getEditCount(),
+                   (unsigned long)liveStatus.getCreateCount(), (unsigned long)liveStatus.getSkippedCount());
+  }
+  discordClient.sendResponse();
+}
@@ -0,0 +1,72 @@
+#include "CommandThrottle.h"
+
+// Global instance
+CommandThrottle commandThrottle;
+
+CommandThrottle::CommandThrottle()
+  : lastNoticeMs(0),
+    noticeSent(false),
+    droppedCount(0),
+    evictionCount(0) {
+  for (Bucket& bucket : buckets) {
+    bucket.kind = BUCKET_FREE;
+  }
+}
+
+ThrottleResult CommandThrottle::admit(uint64_t authorId, uint64_t channelId, uint8_t cost) {
+#if THROTTLE_ENABLED
+  unsigned long now = millis();
+  Bucket& user = acquire(BUCKET_USER, authorId, now);
+  Bucket& channel = acquire(BUCKET_CHANNEL, channelId, now);
+  
+  if (user.tokens >= cost && channel.tokens >= cost) {
+    user.tokens -= cost;
+    channel.tokens -= cost;
+    return THROTTLE_ALLOW;
+  }
+  
+  // One notice per interval covers every sender in the burst
+  droppedCount++;
+  if (!noticeSent || now - lastNoticeMs >= THROTTLE_NOTICE_INTERVAL_MS) {
+    noticeSent = true;
+    lastNoticeMs = now;
+    return THROTTLE_NOTICE;
+  }
+  return THROTTLE_DROP;
+#else
+  return THROTTLE_ALLOW;
+#endif
+}
+
+CommandThrottle::Bucket& CommandThrottle::acquire(BucketKind kind, uint64_t key, unsigned long now) {
+  // Linear scan: the table is small and this runs once per command
+  Bucket* victim = &buckets[0];
+  for (Bucket& bucket : buckets) {
+    if (bucket.kind == kind && bucket.key == key) {
+      refill(bucket, now);
+      bucket.usedMs = now;
+      return bucket;
+    }
+    if (victim->kind != BUCKET_FREE && (bucket.kind == BUCKET_FREE || now - bucket.usedMs > now - victim->usedMs)) {
+      victim = &bucket;
+    }
+  }
+  
+  if (victim->kind != BUCKET_FREE) {
+    evictionCount++;
+  }
+  victim->kind = kind;
+  victim->key = key;
+  victim->tokens = kind == BUCKET_USER ? THROTTLE_USER_BURST : THROTTLE_CHANNEL_BURST;
+  victim->refilledMs = now;
+  victim->usedMs = now;
+  return *victim;
+}
+
+void CommandThrottle::refill(Bucket& bucket, unsigned long now) {
+  float rate = bucket.kind == BUCKET_USER ? THROTTLE_USER_REFILL_PER_SEC : THROTTLE_CHANNEL_REFILL_PER_SEC;
+  float burst = bucket.kind == BUCKET_USER ? THROTTLE_USER_BURST : THROTTLE_CHANNEL_BURST;
+  
+  bucket.tokens = min(burst, bucket.tokens + (now - bucket.refilledMs) * rate / 1000.0f);
+  bucket.refilledMs = now;
+}
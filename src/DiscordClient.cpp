@@ -1,6 +1,64 @@
 #include "DiscordClient.h"
 #include "CommandSystem.h"
+#include "TraceProfiler.h"
+#include "GuildCache.h"
+#include "CommandThrottle.h"
 #include "config.h"
+#include <sys/time.h>
+#include <Preferences.h>
+
+// Discord snowflake epoch (2015-01-01T00:00:00Z) in Unix milliseconds
+static const uint64_t DISCORD_EPOCH_MS = 1420070400000ULL;
+
+// Discord allows max_concurrency IDENTIFYs per window of this length
+static const unsigned long IDENTIFY_WINDOW_MS = 5000;
+
+// How long a sharded board waits for NTP before identifying off-schedule
+static const unsigned long IDENTIFY_CLOCK_TIMEOUT_MS = 60000;
+
+// Frames are logged up to this many bytes
+static const size_t GATEWAY_LOG_BYTES = 256;
+
+// Frames above this size are parsed through gatewayFilter()
+static const size_t GATEWAY_FILTER_BYTES = 4096;
+
+#if WEBSOCKETS_MAX_DATA_SIZE < GATEWAY_MAX_FRAME_BYTES
+#error "WEBSOCKETS_MAX_DATA_SIZE is too small for GUILD_CREATE; see platformio.ini"
+#endif
+
+// Every field the client reads from a dispatch. Large frames (GUILD_CREATE,
+// READY with many guilds) keep only these, so the document stays small while
+// permission overwrites, members, emojis, etc. are skipped during parsing.
+static JsonDocument& gatewayFilter() {
+  static JsonDocument filter;
+  if (filter.isNull()) {
+    filter["op"] = true;
+    filter["s"] = true;
+    filter["t"] = true;
+    JsonObject d = filter["d"].to<JsonObject>();
+    for (const char* key : {"id", "name", "type", "position", "unavailable", "guild_id",
+                            "role_id", "session_id", "channel_id", "content", "heartbeat_interval"}) {
+      d[key] = true;
+    }
+    d["user"]["id"] = true;
+    d["user"]["username"] = true;
+    d["author"]["id"] = true;
+    d["author"]["bot"] = true;
+    d["author"]["username"] = true;
+    d["guilds"][0]["id"] = true;
+    d["guilds"][0]["unavailable"] = true;
+    d["role"]["id"] = true;
+    d["role"]["name"] = true;
+    d["role"]["color"] = true;
+    d["role"]["position"] = true;
+    d["channels"][0]["id"] = true;
+    d["channels"][0]["name"] = true;
+    d["channels"][0]["type"] = true;
+    d["channels"][0]["position"] = true;
+    d["roles"][0] = d["role"];
+  }
+  return filter;
+}
 
 // Global instance
 DiscordClient discordClient;
@@ -15,12 +73,40 @@ DiscordClient::DiscordClient() :
   connectionAttempts(0),
   lastConnectionTime(0),
   isConnected(false),
-  isAuthenticated(false) {
+  isAuthenticated(false),
+  channelBackend(&botBackend),
+  deferredHead(0),
+  deferredCount(0),
+  replyRoute({nullptr, 0}),
+  commandCreatedMs(0),
+  shardId(0),
+  shardCount(1),
+  maxConcurrency(1),
+  identifyPending(false),
+  identifyPendingSince(0) {
   instance = this; // Set static instance for callback
 }
 
 void DiscordClient::begin() {
   httpClient.setInsecure(); // Skip SSL certificate verification for testing
+  
+  // Build request strings once instead of on every send
+  String simulatorUrl = "http://" + String(DISCORD_SIMULATOR_HOST) + ":" + String(DISCORD_SIMULATOR_PORT);
+  String apiUrl = useSimulator() ? simulatorUrl + "/api/v10/channels/" : String(DISCORD_API_URL);
+  authorizationHeader = "Bot " + String(DISCORD_BOT_TOKEN);
+  
+  // The simulator serves webhooks under the same /api/ path as Discord
+  String webhookUrl = DISCORD_WEBHOOK_URL;
+  int webhookPath = webhookUrl.indexOf("/api/");
+  if (useSimulator() && webhookPath >= 0) {
+    webhookUrl = simulatorUrl + webhookUrl.substring(webhookPath);
+  }
+  
+  WiFiClient& restClient = useSimulator() ? simulatorClient : httpClient;
+  botBackend.begin(restClient, apiUrl + String(DISCORD_CHANNEL_ID) + "/messages", authorizationHeader);
+  webhookBackend.begin(restClient, webhookUrl, DISCORD_WEBHOOK_WAIT);
+  loadSendBackend();
+  loadShardConfig();
   Serial.println("Discord client initialized");
   
   // Get Gateway URL from Discord API
@@ -31,13 +117,24 @@ void DiscordClient::begin() {
 }
 
 void DiscordClient::update() {
+  TRACE_SCOPE("DiscordClient::update");
   webSocket.loop();
   
   // Send heartbeat if needed (send slightly before interval to avoid timeout)
-  if (isConnected && isAuthenticated && millis() - lastHeartbeat >= (heartbeatInterval * 0.9)) {
+  if (isConnected && (isAuthenticated || identifyPending) && millis() - lastHeartbeat >= (heartbeatInterval * 0.9)) {
     sendHeartbeat();
   }
   
+  // Paced IDENTIFY waiting for this shard's turn
+  if (isConnected && identifyPending && isIdentifyAllowed()) {
+    sendIdentify();
+  }
+  
+  // One held reply per loop once its bucket has reset
+  if (deferredCount > 0 && channelBackend->isReady()) {
+    sendDeferredReply();
+  }
+  
   // TEMPORARILY DISABLE AUTO-RECONNECTION to avoid Discord rate limiting
   // Only reconnect manually if we've been disconnected for more than 5 minutes
   /*
@@ -50,12 +147,82 @@ void DiscordClient::update() {
   */
 }
 
+bool DiscordClient::useSimulator() const {
+  return DISCORD_SIMULATOR_HOST[0] != '\0';
+}
+
+void DiscordClient::loadSendBackend() {
+  // Webhook by default when one is configured; NVS remembers `send_via`
+  Preferences preferences;
+  preferences.begin("discord", true);
+  bool useWebhook = preferences.getBool("send_hook", webhookBackend.isConfigured());
+  preferences.end();
+  
+  channelBackend = useWebhook && webhookBackend.isConfigured() ? (SendBackend*)&webhookBackend : &botBackend;
+  Serial.println("Replies via " + String(channelBackend->getName()));
+}
+
+bool DiscordClient::setSendBackend(bool useWebhook) {
+  if (useWebhook && !webhookBackend.isConfigured()) {
+    return false;
+  }
+  channelBackend = useWebhook ? (SendBackend*)&webhookBackend : &botBackend;
+  
+  Preferences preferences;
+  if (preferences.begin("discord", false)) {
+    preferences.putBool("send_hook", useWebhook);
+    preferences.end();
+  }
+  return true;
+}
+
+void DiscordClient::loadShardConfig() {
+  // NVS overrides config.cpp so one firmware image can serve a whole fleet
+  Preferences preferences;
+  preferences.begin("discord", true);
+  shardId = preferences.getUShort("shard_id", DISCORD_SHARD_ID);
+  shardCount = preferences.getUShort("shard_count", DISCORD_SHARD_COUNT);
+  preferences.end();
+  
+  if (shardCount == 0 || shardId >= shardCount) {
+    Serial.println("Invalid shard configuration, falling back to unsharded");
+    shardId = 0;
+    shardCount = 1;
+  }
+  Serial.println("Shard " + String(shardId) + " of " + String(shardCount));
+}
+
+bool DiscordClient::saveShardConfig(uint16_t id, uint16_t count) {
+  if (count == 0 || id >= count) {
+    return false;
+  }
+  
+  Preferences preferences;
+  if (!preferences.begin("discord", false)) {
+    return false;
+  }
+  bool saved = preferences.putUShort("shard_id", id) > 0 && preferences.putUShort("shard_count", count) > 0;
+  preferences.end();
+  return saved;
+}
+
 void DiscordClient::getGatewayUrl() {
+  String defaultUrl = useSimulator()
+    ? "ws://" + String(DISCORD_SIMULATOR_HOST) + ":" + String(DISCORD_SIMULATOR_PORT)
+    : "wss://gateway.discord.gg";
+  String botGatewayUrl = useSimulator()
+    ? "http://" + String(DISCORD_SIMULATOR_HOST) + ":" + String(DISCORD_SIMULATOR_PORT) + "/api/v10/gateway/bot"
+    : "https://discord.com/api/v10/gateway/bot";
+  
   Serial.println("Getting Discord Gateway URL...");
   
   HTTPClient http;
-  http.begin(httpClient, "https://discord.com/api/v10/gateway");
-  http.addHeader("Authorization", "Bot " + String(DISCORD_BOT_TOKEN));
+  if (useSimulator()) {
+    http.begin(simulatorClient, botGatewayUrl);
+  } else {
+    http.begin(httpClient, botGatewayUrl);
+  }
+  http.addHeader("Authorization", authorizationHeader);
   http.setTimeout(10000);
   
   int httpCode = http.GET();
@@ -67,19 +234,54 @@ void DiscordClient::getGatewayUrl() {
     JsonDocument doc;
     if (deserializeJson(doc, response) == DeserializationError::Ok) {
       gatewayUrl = doc["url"].as<String>();
+      maxConcurrency = max(1, doc["session_start_limit"]["max_concurrency"].as<int>());
       Serial.println("Gateway URL: " + gatewayUrl);
+      Serial.println("Recommended shards: " + String(doc["shards"].as<int>()) +
+                     ", max_concurrency: " + String(maxConcurrency));
     } else {
       Serial.println("Failed to parse gateway response");
-      gatewayUrl = "wss://gateway.discord.gg"; // Fallback
+      gatewayUrl = defaultUrl; // Fallback
     }
   } else {
     Serial.println("Failed to get gateway URL, using default");
-    gatewayUrl = "wss://gateway.discord.gg"; // Fallback
+    gatewayUrl = defaultUrl; // Fallback
   }
   
   http.end();
 }
 
+bool DiscordClient::isIdentifyAllowed() const {
+  // Shards identify in waves of max_concurrency (one per rate-limit bucket,
+  // shard_id % max_concurrency). Wave w owns slot w of two windows and only
+  // identifies in the slot's first window minus a second of clock skew, so
+  // consecutive waves are always more than one window apart.
+  // tools/discord_sim.py (identify_allowed) mirrors this schedule.
+  uint16_t waves = (shardCount + maxConcurrency - 1) / maxConcurrency;
+  if (waves <= 1) {
+    return true;
+  }
+  uint16_t wave = shardId / maxConcurrency;
+  
+  // With NTP time every board agrees on the slot schedule, so the fleet
+  // needs no coordination
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  if (now.tv_sec > 1600000000) {
+    uint64_t nowMs = (uint64_t)now.tv_sec * 1000ULL + now.tv_usec / 1000;
+    uint64_t slot = nowMs / (2 * IDENTIFY_WINDOW_MS);
+    return slot % waves == wave && nowMs % (2 * IDENTIFY_WINDOW_MS) < IDENTIFY_WINDOW_MS - 1000;
+  }
+  
+  // A local stagger would not be shared with boards that connected at other
+  // times, so wait for the clock instead; after the timeout, a collision
+  // only costs an invalid session and a retry
+  if (millis() - identifyPendingSince < IDENTIFY_CLOCK_TIMEOUT_MS) {
+    return false;
+  }
+  Serial.println("No NTP time yet; identifying outside the shared schedule");
+  return true;
+}
+
 void DiscordClient::connectWebSocket() {
   connectionAttempts++;
   lastConnectionTime = millis();
@@ -101,11 +303,15 @@ void DiscordClient::connectWebSocket() {
     }
   }
   
-  // Extract host and path from gateway URL
-  String host = gatewayUrl;
-  host.replace("wss://", "");
-  
-  webSocket.beginSSL(host, 443, "/?v=10&encoding=json");
+  if (useSimulator()) {
+    webSocket.begin(DISCORD_SIMULATOR_HOST, DISCORD_SIMULATOR_PORT, "/?v=10&encoding=json");
+  } else {
+    // Extract host and path from gateway URL
+    String host = gatewayUrl;
+    host.replace("wss://", "");
+    
+    webSocket.beginSSL(host, 443, "/?v=10&encoding=json");
+  }
   webSocket.onEvent([](WStype_t type, uint8_t * payload, size_t length) {
     if (DiscordClient::instance) {
       DiscordClient::instance->handleWebSocketEvent(type, payload, length);
@@ -132,6 +338,7 @@ void DiscordClient::handleWebSocketEvent(WStype_t type, uint8_t * payload, size_
       Serial.println("Connection was active for: " + String(millis() - lastHeartbeat) + "ms since last heartbeat");
       isConnected = false;
       isAuthenticated = false;
+      identifyPending = false;
       sequenceNumber = 0;
       lastHeartbeat = 0;
       
@@ -153,6 +360,7 @@ void DiscordClient::handleWebSocketEvent(WStype_t type, uint8_t * payload, size_
       Serial.println(" seconds before reconnect attempt...");
       
       // Use non-blocking delay to prevent watchdog reset
+      TRACE_SCOPE("Reconnect wait");
       unsigned long waitStart = millis();
       while (millis() - waitStart < reconnectDelay) {
         delay(100); // Small delays to feed watchdog
@@ -172,11 +380,23 @@ void DiscordClient::handleWebSocketEvent(WStype_t type, uint8_t * payload, size_
     }
       
     case WStype_TEXT: {
-      String message = String((char*)payload);
-      Serial.println("Received: " + message);
+      TRACE_SCOPE("Gateway event");
+      // Parsed in place; GUILD_CREATE frames can be hundreds of KB
+      Serial.printf("Received %u bytes: %.*s\n", (unsigned)length,
+                    (int)min(length, (size_t)GATEWAY_LOG_BYTES), (const char*)payload);
       
       JsonDocument doc;
-      if (deserializeJson(doc, message) == DeserializationError::Ok) {
+      DeserializationError error;
+      {
+        TRACE_SCOPE("Gateway parse");
+        if (length > GATEWAY_FILTER_BYTES) {
+          error = deserializeJson(doc, (const char*)payload, length,
+                                  DeserializationOption::Filter(gatewayFilter()));
+        } else {
+          error = deserializeJson(doc, (const char*)payload, length);
+        }
+      }
+      if (error == DeserializationError::Ok) {
         int opcode = doc["op"];
         
         // Update sequence number if present
@@ -196,7 +416,9 @@ void DiscordClient::handleWebSocketEvent(WStype_t type, uint8_t * payload, size_
               Serial.println("Attempting to resume session...");
               sendResume();
             } else {
-              sendIdentify();
+              // Sent from update() once this shard's identify window opens
+              identifyPending = true;
+              identifyPendingSince = millis();
             }
             break;
             
@@ -209,10 +431,9 @@ void DiscordClient::handleWebSocketEvent(WStype_t type, uint8_t * payload, size_
               sequenceNumber = doc["s"].as<int>();
             }
             String eventType = doc["t"].as<String>();
-            JsonDocument eventData = doc["d"];
             
             Serial.println("Event: " + eventType);
-            handleDiscordMessage(eventType, eventData);
+            handleDiscordMessage(eventType, doc["d"].as<JsonObject>());
             break;
           }
           
@@ -276,20 +497,23 @@ void DiscordClient::sendIdentify() {
   JsonDocument identify;
   identify["op"] = 2;
   identify["d"]["token"] = DISCORD_BOT_TOKEN;
-  identify["d"]["intents"] = 33280; // GUILD_MESSAGES (512) + MESSAGE_CONTENT (32768) = 33280
+  identify["d"]["intents"] = 33281; // GUILDS (1) + GUILD_MESSAGES (512) + MESSAGE_CONTENT (32768) = 33281
   identify["d"]["properties"]["$os"] = "ESP32";
   identify["d"]["properties"]["$browser"] = "ESP32-Discord-Bot";
   identify["d"]["properties"]["$device"] = "ESP32";
+  identify["d"]["shard"][0] = shardId;
+  identify["d"]["shard"][1] = shardCount;
   
   String identifyStr;
   serializeJson(identify, identifyStr);
   
-  Serial.println("Sending IDENTIFY with intents: 33280 (GUILD_MESSAGES + MESSAGE_CONTENT)");
+  Serial.println("Sending IDENTIFY with intents: 33281 (GUILDS + GUILD_MESSAGES + MESSAGE_CONTENT)");
   Serial.println("MESSAGE_CONTENT_INTENT should now be enabled in Developer Portal!");
   
   webSocket.sendTXT(identifyStr);
   isAuthenticated = true;
-  Serial.println("Identify sent");
+  identifyPending = false;
+  Serial.println("Identify sent for shard " + String(shardId) + "/" + String(shardCount));
 }
 
 void DiscordClient::sendResume() {
@@ -306,10 +530,15 @@ void DiscordClient::sendResume() {
   Serial.println("Resume sent for session: " + sessionId + " with seq: " + String(sequenceNumber));
 }
 
-void DiscordClient::handleDiscordMessage(const String& eventType, JsonDocument& data) {
+void DiscordClient::handleDiscordMessage(const String& eventType, JsonObject data) {
   if (eventType == "MESSAGE_CREATE") {
     processMessage(data);
-  } else if (eventType == "READY") {
+    return;
+  }
+  
+  guildCache.handleDispatch(eventType, data);
+  
+  if (eventType == "READY") {
     sessionId = data["session_id"].as<String>();
     lastReadyTime = millis();
     Serial.println("Bot is ready! Session ID: " + sessionId);
@@ -349,7 +578,7 @@ void DiscordClient::handleDiscordMessage(const String& eventType, JsonDocument&
   }
 }
 
-void DiscordClient::processMessage(JsonDocument& messageData) {
+void DiscordClient::processMessage(JsonObject messageData) {
   String channelId = messageData["channel_id"].as<String>();
   String messageId = messageData["id"].as<String>();
   String content = messageData["content"].as<String>();
@@ -365,56 +594,132 @@ void DiscordClient::processMessage(JsonDocument& messageData) {
       messageId != lastMessageId && 
       content.length() > 0) {
     
-    Serial.println("Processing new message: " + content);
-    processNewMessage(content);
+    // Drop bursts here, before they cost an LED update and a POST
+    uint8_t cost = commandSystem.getCommandCost(content.c_str(), content.length());
+    ThrottleResult throttle = commandThrottle.admit(strtoull(authorId.c_str(), nullptr, 10),
+                                                    strtoull(channelId.c_str(), nullptr, 10), cost);
+    if (throttle == THROTTLE_ALLOW) {
+      Serial.println("Processing new message: " + content);
+      processNewMessage(content, messageId);
+    } else {
+      Serial.println("Throttled message from " + username);
+      if (throttle == THROTTLE_NOTICE) {
+        sendStaticReply(STATIC_REPLY("🐢 **Slow down!** Some commands are being ignored. Wait a few seconds and try again."));
+      }
+    }
     lastMessageId = messageId;
   }
 }
 
-void DiscordClient::processNewMessage(const String& message) {
+void DiscordClient::processNewMessage(const String& message, const String& messageId) {
   Serial.println("Processing message for commands: '" + message + "'");
+  
+  // Snowflakes carry their creation time (ms since the Discord epoch)
+  commandCreatedMs = (strtoull(messageId.c_str(), nullptr, 10) >> 22) + DISCORD_EPOCH_MS;
   commandSystem.executeCommand(message);
+  commandCreatedMs = 0;
+}
+
+ReplyRoute DiscordClient::setReplyRoute(const ReplyRoute& route) {
+  ReplyRoute previous = replyRoute;
+  replyRoute = route;
+  return previous;
 }
 
-bool DiscordClient::sendMessage(const String& message) {
-  String url = String(DISCORD_API_URL) + String(DISCORD_CHANNEL_ID) + "/messages";
+bool DiscordClient::sendMessage(const char* message) {
+  beginResponse().content(message);
+  return sendResponse();
+}
+
+bool DiscordClient::sendResponse() {
+  response.finish();
+  return sendPayload(response.data(), response.length());
+}
+
+bool DiscordClient::sendPayload(const char* payload, size_t length) {
+  if (replyRoute.handler) {
+    return replyRoute.handler(payload, length, replyRoute.context);
+  }
   
-  Serial.println("Sending message to: " + url);
-  Serial.println("Message content: " + message);
+  // Keep order behind replies already waiting for the bucket
+  if (deferredCount > 0) {
+    return deferReply(payload, length);
+  }
   
-  HTTPClient http;
-  http.begin(httpClient, url);
-  http.addHeader("Authorization", "Bot " + String(DISCORD_BOT_TOKEN));
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(10000);
+  int httpCode = channelBackend->post(payload, length);
+  if (httpCode == SendBackend::RATE_LIMITED || httpCode == 429) {
+    return deferReply(payload, length);
+  }
+  bool success = httpCode / 100 == 2;
+  if (success) {
+    recordCommandLatency();
+  }
+  return success;
+}
 
-  // Create proper JSON using ArduinoJson library
-  JsonDocument doc;
-  doc["content"] = message;
-  String payload;
-  serializeJson(doc, payload);
+bool DiscordClient::deferReply(const char* payload, size_t length) {
+  if (deferredCount >= DEFERRED_REPLY_SLOTS) {
+    Serial.println("Deferred replies full, dropping reply");
+    return false;
+  }
   
-  Serial.println("JSON Payload: " + payload);
+  uint8_t slot = (deferredHead + deferredCount) % DEFERRED_REPLY_SLOTS;
+  deferredReplies[slot] = String();
+  deferredReplies[slot].concat(payload, length);
+  deferredCreatedMs[slot] = commandCreatedMs;
+  deferredCount++;
+  Serial.printf("Reply deferred until the %s bucket resets (%u waiting)\n",
+                channelBackend->getName(), deferredCount);
+  return true;
+}
 
-  int httpCode = http.POST(payload);
-  bool success = false;
-  
-  Serial.println("HTTP Response Code: " + String(httpCode));
+void DiscordClient::sendDeferredReply() {
+  String& payload = deferredReplies[deferredHead];
+  int httpCode = channelBackend->post(payload.c_str(), payload.length());
+  if (httpCode == SendBackend::RATE_LIMITED || httpCode == 429) {
+    return; // Still limited; try again on a later loop
+  }
   
-  if (httpCode > 0) {
-    String response = http.getString();
-    
-    if (httpCode == 200 || httpCode == 201) {
-      Serial.println("Message sent successfully");
-      success = true;
-    } else {
-      Serial.println("Discord API returned error code: " + String(httpCode));
-      Serial.println("Error response: " + response);
-    }
-  } else {
-    Serial.println("HTTP request failed with code: " + String(httpCode));
+  if (httpCode / 100 == 2) {
+    uint64_t current = commandCreatedMs;
+    commandCreatedMs = deferredCreatedMs[deferredHead];
+    recordCommandLatency();
+    commandCreatedMs = current;
+  }
+  payload = String(); // Free the copy
+  deferredHead = (deferredHead + 1) % DEFERRED_REPLY_SLOTS;
+  deferredCount--;
+}
+
+bool DiscordClient::createMessage(const char* payload, size_t length, uint64_t& messageId) {
+  String body;
+  if (channelBackend->post(payload, length, &body) / 100 != 2) {
+    return false;
   }
   
-  http.end();
-  return success;
+  JsonDocument doc;
+  if (deserializeJson(doc, body) != DeserializationError::Ok) {
+    Serial.println("Failed to parse created message");
+    return false;
+  }
+  messageId = GuildCache::parseSnowflake(doc["id"].as<const char*>());
+  return messageId != 0;
+}
+
+int DiscordClient::editMessage(uint64_t messageId, const char* payload, size_t length) {
+  return channelBackend->edit(messageId, payload, length);
+}
+
+void DiscordClient::recordCommandLatency() {
+  // Only the first reply to a message counts, and only with a synced clock
+  if (commandCreatedMs == 0) {
+    return;
+  }
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  uint64_t nowMs = (uint64_t)now.tv_sec * 1000ULL + now.tv_usec / 1000;
+  if (now.tv_sec > 1600000000 && nowMs >= commandCreatedMs) {
+    commandLatency.add((uint32_t)min<uint64_t>((nowMs - commandCreatedMs) * 1000ULL, UINT32_MAX));
+  }
+  commandCreatedMs = 0;
 }
@@ -0,0 +1,536 @@
+#include "GuildCache.h"
+
+// Global instance
+GuildCache guildCache;
+
+// Large tables go to PSRAM so they don't compete with the network stack
+static void* cacheAlloc(size_t size) {
+  return psramFound() ? ps_malloc(size) : malloc(size);
+}
+
+// Power-of-two table with at least twice the capacity (load factor <= 0.5)
+static uint32_t tableSize(uint32_t capacity) {
+  uint32_t size = 1;
+  while (size < capacity * 2) {
+    size <<= 1;
+  }
+  return size;
+}
+
+bool SnowflakeIndex::allocate(uint32_t capacity, size_t& bytes) {
+  uint32_t size = tableSize(capacity);
+  slots = (uint16_t*)cacheAlloc(size * sizeof(uint16_t));
+  if (!slots) return false;
+  
+  mask = size - 1;
+  bytes += size * sizeof(uint16_t);
+  clear();
+  return true;
+}
+
+void SnowflakeIndex::clear() {
+  if (slots) {
+    memset(slots, 0, (mask + 1) * sizeof(uint16_t));
+  }
+}
+
+uint32_t SnowflakeIndex::home(uint64_t id) const {
+  // Fibonacci hashing mixes the timestamp bits into the low bits we keep
+  return (uint32_t)((id * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+int32_t SnowflakeIndex::findSlot(const uint64_t* ids, uint64_t id) const {
+  uint32_t slot = home(id);
+  while (slots[slot]) {
+    if (ids[slots[slot] - 1] == id) return slot;
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+int32_t SnowflakeIndex::find(const uint64_t* ids, uint64_t id) const {
+  int32_t slot = findSlot(ids, id);
+  return slot < 0 ? -1 : slots[slot] - 1;
+}
+
+void SnowflakeIndex::insert(uint64_t id, uint16_t row) {
+  uint32_t slot = home(id);
+  while (slots[slot]) {
+    slot = (slot + 1) & mask;
+  }
+  slots[slot] = row + 1;
+}
+
+void SnowflakeIndex::remove(const uint64_t* ids, uint64_t id) {
+  int32_t found = findSlot(ids, id);
+  if (found < 0) return;
+  
+  // Pull later entries of the probe chain back into the hole
+  uint32_t hole = found;
+  uint32_t slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask;
+    if (!slots[slot]) break;
+  
+    uint32_t wanted = home(ids[slots[slot] - 1]);
+    bool staysPut = hole <= slot ? (hole < wanted && wanted <= slot) : (hole < wanted || wanted <= slot);
+    if (!staysPut) {
+      slots[hole] = slots[slot];
+      hole = slot;
+    }
+  }
+  slots[hole] = 0;
+}
+
+void SnowflakeIndex::move(const uint64_t* ids, uint64_t id, uint16_t row) {
+  int32_t slot = findSlot(ids, id);
+  if (slot >= 0) {
+    slots[slot] = row + 1;
+  }
+}
+
+GuildCache::GuildCache()
+  : guildIds(nullptr),
+    guildNames(nullptr),
+    guildCount(0),
+    channelIds(nullptr),
+    channelGuilds(nullptr),
+    channelNames(nullptr),
+    channelTypes(nullptr),
+    channelPositions(nullptr),
+    channelCount(0),
+    roleIds(nullptr),
+    roleGuilds(nullptr),
+    roleNames(nullptr),
+    roleColors(nullptr),
+    rolePositions(nullptr),
+    roleCount(0),
+    poolData(nullptr),
+    poolUsed(0),
+    internSlots(nullptr),
+    internMask(0),
+    internCount(0),
+    deadBytes(0),
+    deadCount(0),
+    compacting(false),
+    memoryBytes(0),
+    droppedCount(0) {
+}
+
+bool GuildCache::begin() {
+  if (poolData) return true;
+  
+  // Every table is sized once here; the cache never allocates afterwards
+  // except for the temporary pool used while compacting
+  size_t bytes = 0;
+  guildIds = (uint64_t*)cacheAlloc(MAX_GUILDS * sizeof(uint64_t));
+  guildNames = (uint32_t*)cacheAlloc(MAX_GUILDS * sizeof(uint32_t));
+  bytes += MAX_GUILDS * (sizeof(uint64_t) + sizeof(uint32_t));
+  
+  channelIds = (uint64_t*)cacheAlloc(MAX_CHANNELS * sizeof(uint64_t));
+  channelGuilds = (uint16_t*)cacheAlloc(MAX_CHANNELS * sizeof(uint16_t));
+  channelNames = (uint32_t*)cacheAlloc(MAX_CHANNELS * sizeof(uint32_t));
+  channelTypes = (uint8_t*)cacheAlloc(MAX_CHANNELS * sizeof(uint8_t));
+  channelPositions = (uint16_t*)cacheAlloc(MAX_CHANNELS * sizeof(uint16_t));
+  bytes += MAX_CHANNELS * (sizeof(uint64_t) + 2 * sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t));
+  
+  roleIds = (uint64_t*)cacheAlloc(MAX_ROLES * sizeof(uint64_t));
+  roleGuilds = (uint16_t*)cacheAlloc(MAX_ROLES * sizeof(uint16_t));
+  roleNames = (uint32_t*)cacheAlloc(MAX_ROLES * sizeof(uint32_t));
+  roleColors = (uint32_t*)cacheAlloc(MAX_ROLES * sizeof(uint32_t));
+  rolePositions = (uint16_t*)cacheAlloc(MAX_ROLES * sizeof(uint16_t));
+  bytes += MAX_ROLES * (sizeof(uint64_t) + 2 * sizeof(uint16_t) + 2 * sizeof(uint32_t));
+  
+  uint32_t internSize = tableSize(MAX_GUILDS + MAX_CHANNELS + MAX_ROLES);
+  internSlots = (uint32_t*)cacheAlloc(internSize * sizeof(uint32_t));
+  internMask = internSize - 1;
+  bytes += internSize * sizeof(uint32_t) + POOL_BYTES;
+  
+  bool indexed = guildIndex.allocate(MAX_GUILDS, bytes) &&
+                 channelIndex.allocate(MAX_CHANNELS, bytes) &&
+                 roleIndex.allocate(MAX_ROLES, bytes);
+  char* pool = (char*)cacheAlloc(POOL_BYTES);
+  
+  if (!indexed || !pool || !guildIds || !guildNames || !channelIds || !channelGuilds || !channelNames ||
+      !channelTypes || !channelPositions || !roleIds || !roleGuilds || !roleNames || !roleColors ||
+      !rolePositions || !internSlots) {
+    Serial.println("Guild cache: allocation failed, cache disabled");
+    return false;
+  }
+  
+  poolData = pool;
+  memoryBytes = bytes;
+  clear();
+  Serial.printf("Guild cache: %u guilds, %u channels, %u roles in %u bytes of %s\n",
+                MAX_GUILDS, MAX_CHANNELS, MAX_ROLES, (unsigned)memoryBytes, psramFound() ? "PSRAM" : "heap");
+  return true;
+}
+
+void GuildCache::clear() {
+  if (!poolData) return;
+  
+  guildCount = 0;
+  channelCount = 0;
+  roleCount = 0;
+  guildIndex.clear();
+  channelIndex.clear();
+  roleIndex.clear();
+  
+  poolData[0] = '\0';
+  poolUsed = 1;
+  memset(internSlots, 0, (internMask + 1) * sizeof(uint32_t));
+  internCount = 0;
+  deadBytes = 0;
+  deadCount = 0;
+}
+
+uint64_t GuildCache::parseSnowflake(const char* text) {
+  return text ? strtoull(text, nullptr, 10) : 0;
+}
+
+void GuildCache::handleDispatch(const String& eventType, JsonObject data) {
+  if (!poolData) return;
+  
+  if (eventType == "READY") {
+    // A new session re-sends every guild as GUILD_CREATE
+    clear();
+  
+  } else if (eventType == "GUILD_CREATE" || eventType == "GUILD_UPDATE") {
+    if (data["unavailable"].as<bool>()) return;
+  
+    uint64_t guildId = parseSnowflake(data["id"].as<const char*>());
+    if (!upsertGuild(guildId, data["name"].as<const char*>())) return;
+  
+    // GUILD_UPDATE carries roles but not channels
+    for (JsonObject channel : data["channels"].as<JsonArray>()) {
+      upsertChannelJson(guildId, channel);
+    }
+    for (JsonObject role : data["roles"].as<JsonArray>()) {
+      upsertRoleJson(guildId, role);
+    }
+    Serial.printf("Guild cache: %u guilds, %u channels, %u roles, %lu/%lu string bytes, %lu dropped\n",
+                  guildCount, channelCount, roleCount, (unsigned long)poolUsed,
+                  (unsigned long)POOL_BYTES, (unsigned long)droppedCount);
+  
+  } else if (eventType == "GUILD_DELETE") {
+    removeGuild(parseSnowflake(data["id"].as<const char*>()));
+  
+  } else if (eventType == "CHANNEL_CREATE" || eventType == "CHANNEL_UPDATE") {
+    upsertChannelJson(parseSnowflake(data["guild_id"].as<const char*>()), data);
+  
+  } else if (eventType == "CHANNEL_DELETE") {
+    removeChannel(parseSnowflake(data["id"].as<const char*>()));
+  
+  } else if (eventType == "GUILD_ROLE_CREATE" || eventType == "GUILD_ROLE_UPDATE") {
+    upsertRoleJson(parseSnowflake(data["guild_id"].as<const char*>()), data["role"].as<JsonObject>());
+  
+  } else if (eventType == "GUILD_ROLE_DELETE") {
+    removeRole(parseSnowflake(data["role_id"].as<const char*>()));
+  }
+}
+
+// Positions are stored as uint16_t; larger values only occur in huge guilds
+static uint16_t clampPosition(int32_t position) {
+  return position < 0 ? 0 : (position > 0xFFFF ? 0xFFFF : position);
+}
+
+void GuildCache::upsertChannelJson(uint64_t guildId, JsonObject channel) {
+  upsertChannel(parseSnowflake(channel["id"].as<const char*>()), guildId,
+                channel["name"].as<const char*>(), channel["type"].as<uint8_t>(),
+                clampPosition(channel["position"].as<int32_t>()));
+}
+
+void GuildCache::upsertRoleJson(uint64_t guildId, JsonObject role) {
+  upsertRole(parseSnowflake(role["id"].as<const char*>()), guildId,
+             role["name"].as<const char*>(), role["color"].as<uint32_t>(),
+             clampPosition(role["position"].as<int32_t>()));
+}
+
+bool GuildCache::upsertGuild(uint64_t id, const char* name) {
+  if (!poolData || id == 0) return false;
+  
+  int32_t row = guildIndex.find(guildIds, id);
+  if (row < 0) {
+    if (guildCount >= MAX_GUILDS) {
+      droppedCount++;
+      return false;
+    }
+    row = guildCount++;
+    guildIds[row] = id;
+    guildNames[row] = 0;
+    guildIndex.insert(id, row);
+  }
+  
+  // Assigned after intern() since compaction rewrites the name columns
+  uint32_t nameOffset = intern(name);
+  if (guildNames[row] != nameOffset) release(guildNames[row]);
+  guildNames[row] = nameOffset;
+  return true;
+}
+
+bool GuildCache::upsertChannel(uint64_t id, uint64_t guildId, const char* name, uint8_t type, uint16_t position) {
+  if (!poolData || id == 0) return false;
+  
+  int32_t guildRow = guildIndex.find(guildIds, guildId);
+  if (guildRow < 0) return false;
+  
+  int32_t row = channelIndex.find(channelIds, id);
+  if (row < 0) {
+    if (channelCount >= MAX_CHANNELS) {
+      droppedCount++;
+      return false;
+    }
+    row = channelCount++;
+    channelIds[row] = id;
+    channelNames[row] = 0;
+    channelIndex.insert(id, row);
+  }
+  
+  channelGuilds[row] = guildRow;
+  channelTypes[row] = type;
+  channelPositions[row] = position;
+  uint32_t nameOffset = intern(name);
+  if (channelNames[row] != nameOffset) release(channelNames[row]);
+  channelNames[row] = nameOffset;
+  return true;
+}
+
+bool GuildCache::upsertRole(uint64_t id, uint64_t guildId, const char* name, uint32_t color, uint16_t position) {
+  if (!poolData || id == 0) return false;
+  
+  int32_t guildRow = guildIndex.find(guildIds, guildId);
+  if (guildRow < 0) return false;
+  
+  int32_t row = roleIndex.find(roleIds, id);
+  if (row < 0) {
+    if (roleCount >= MAX_ROLES) {
+      droppedCount++;
+      return false;
+    }
+    row = roleCount++;
+    roleIds[row] = id;
+    roleNames[row] = 0;
+    roleIndex.insert(id, row);
+  }
+  
+  roleGuilds[row] = guildRow;
+  roleColors[row] = color;
+  rolePositions[row] = position;
+  uint32_t nameOffset = intern(name);
+  if (roleNames[row] != nameOffset) release(roleNames[row]);
+  roleNames[row] = nameOffset;
+  return true;
+}
+
+void GuildCache::removeGuild(uint64_t id) {
+  if (!poolData) return;
+  
+  int32_t row = guildIndex.find(guildIds, id);
+  if (row < 0) return;
+  
+  // Walk backwards so swap-removal never skips a row
+  for (int32_t i = channelCount - 1; i >= 0; i--) {
+    if (channelGuilds[i] == row) removeChannelRow(i);
+  }
+  for (int32_t i = roleCount - 1; i >= 0; i--) {
+    if (roleGuilds[i] == row) removeRoleRow(i);
+  }
+  
+  release(guildNames[row]);
+  guildIndex.remove(guildIds, id);
+  uint16_t last = --guildCount;
+  if (row != last) {
+    guildIds[row] = guildIds[last];
+    guildNames[row] = guildNames[last];
+    guildIndex.move(guildIds, guildIds[last], row);
+  
+    for (uint16_t i = 0; i < channelCount; i++) {
+      if (channelGuilds[i] == last) channelGuilds[i] = row;
+    }
+    for (uint16_t i = 0; i < roleCount; i++) {
+      if (roleGuilds[i] == last) roleGuilds[i] = row;
+    }
+  }
+}
+
+void GuildCache::removeChannel(uint64_t id) {
+  if (!poolData) return;
+  
+  int32_t row = channelIndex.find(channelIds, id);
+  if (row >= 0) removeChannelRow(row);
+}
+
+void GuildCache::removeRole(uint64_t id) {
+  if (!poolData) return;
+  
+  int32_t row = roleIndex.find(roleIds, id);
+  if (row >= 0) removeRoleRow(row);
+}
+
+void GuildCache::removeChannelRow(uint16_t row) {
+  release(channelNames[row]);
+  channelIndex.remove(channelIds, channelIds[row]);
+  uint16_t last = --channelCount;
+  if (row == last) return;
+  
+  // Keep rows dense: move the last row into the gap
+  channelIds[row] = channelIds[last];
+  channelGuilds[row] = channelGuilds[last];
+  channelNames[row] = channelNames[last];
+  channelTypes[row] = channelTypes[last];
+  channelPositions[row] = channelPositions[last];
+  channelIndex.move(channelIds, channelIds[last], row);
+}
+
+void GuildCache::removeRoleRow(uint16_t row) {
+  release(roleNames[row]);
+  roleIndex.remove(roleIds, roleIds[row]);
+  uint16_t last = --roleCount;
+  if (row == last) return;
+  
+  roleIds[row] = roleIds[last];
+  roleGuilds[row] = roleGuilds[last];
+  roleNames[row] = roleNames[last];
+  roleColors[row] = roleColors[last];
+  rolePositions[row] = rolePositions[last];
+  roleIndex.move(roleIds, roleIds[last], row);
+}
+
+const char* GuildCache::getGuildName(uint64_t id) const {
+  if (!poolData) return nullptr;
+  
+  int32_t row = guildIndex.find(guildIds, id);
+  return row < 0 ? nullptr : poolData + guildNames[row];
+}
+
+bool GuildCache::getChannel(uint64_t id, CachedChannel& channel) const {
+  if (!poolData) return false;
+  
+  int32_t row = channelIndex.find(channelIds, id);
+  if (row < 0) return false;
+  
+  channel.id = id;
+  channel.guildId = guildIds[channelGuilds[row]];
+  channel.name = poolData + channelNames[row];
+  channel.type = channelTypes[row];
+  channel.position = channelPositions[row];
+  return true;
+}
+
+bool GuildCache::getRole(uint64_t id, CachedRole& role) const {
+  if (!poolData) return false;
+  
+  int32_t row = roleIndex.find(roleIds, id);
+  if (row < 0) return false;
+  
+  role.id = id;
+  role.guildId = guildIds[roleGuilds[row]];
+  role.name = poolData + roleNames[row];
+  role.color = roleColors[row];
+  role.position = rolePositions[row];
+  return true;
+}
+
+uint32_t GuildCache::intern(const char* text) {
+  if (!text || !*text) return 0;
+  
+  // Clamp to MAX_NAME_BYTES without splitting a UTF-8 sequence
+  size_t length = strnlen(text, MAX_NAME_BYTES + 1);
+  if (length > MAX_NAME_BYTES) {
+    length = MAX_NAME_BYTES;
+    while (length > 0 && (text[length] & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+  
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)text[i]) * 16777619UL;
+  }
+  
+  uint32_t slot = hash & internMask;
+  while (internSlots[slot]) {
+    const char* existing = poolData + internSlots[slot] - 1;
+    if (strncmp(existing, text, length) == 0 && existing[length] == '\0') {
+      return internSlots[slot] - 1;
+    }
+    slot = (slot + 1) & internMask;
+  }
+  
+  // Renames and removals leave dead strings behind; reclaim them once space
+  // runs out, but only when enough has died for a compaction to pay off
+  if (!hasRoom(length)) {
+    if (compacting || !compactionMayHelp(length) || !compact() || !hasRoom(length)) {
+      droppedCount++;
+      return 0;
+    }
+    return intern(text); // Slots moved during compaction
+  }
+  
+  uint32_t offset = poolUsed;
+  memcpy(poolData + offset, text, length);
+  poolData[offset + length] = '\0';
+  poolUsed += length + 1;
+  internSlots[slot] = offset + 1;
+  internCount++;
+  return offset;
+}
+
+bool GuildCache::hasRoom(size_t length) const {
+  // Keep the intern table at most 3/4 full so probe chains stay short
+  return poolUsed + length + 1 <= POOL_BYTES && (internCount + 1) * 4 <= (internMask + 1) * 3;
+}
+
+bool GuildCache::compactionMayHelp(size_t length) const {
+  // Thresholds keep churn from compacting the whole pool on every rename
+  if (poolUsed + length + 1 > POOL_BYTES && deadBytes < max((uint32_t)length + 1, POOL_BYTES / 16)) {
+    return false;
+  }
+  if ((internCount + 1) * 4 > (internMask + 1) * 3 && deadCount < (internMask + 1) / 16) {
+    return false;
+  }
+  return true;
+}
+
+void GuildCache::release(uint32_t offset) {
+  if (offset == 0) return;
+  deadBytes += strlen(poolData + offset) + 1;
+  deadCount++;
+}
+
+bool GuildCache::compact() {
+  char* newPool = (char*)cacheAlloc(POOL_BYTES);
+  if (!newPool) {
+    Serial.println("Guild cache: no memory to compact string pool");
+    return false;
+  }
+  
+  // Re-intern every live name into a fresh pool; unreferenced strings are dropped
+  char* oldPool = poolData;
+  uint32_t oldUsed = poolUsed;
+  compacting = true;
+  poolData = newPool;
+  poolData[0] = '\0';
+  poolUsed = 1;
+  memset(internSlots, 0, (internMask + 1) * sizeof(uint32_t));
+  internCount = 0;
+  
+  for (uint16_t i = 0; i < guildCount; i++) {
+    guildNames[i] = intern(oldPool + guildNames[i]);
+  }
+  for (uint16_t i = 0; i < channelCount; i++) {
+    channelNames[i] = intern(oldPool + channelNames[i]);
+  }
+  for (uint16_t i = 0; i < roleCount; i++) {
+    roleNames[i] = intern(oldPool + roleNames[i]);
+  }
+  
+  compacting = false;
+  deadBytes = 0;
+  deadCount = 0;
+  free(oldPool);
+  Serial.printf("Guild cache: compacted strings from %lu to %lu bytes\n",
+                (unsigned long)oldUsed, (unsigned long)poolUsed);
+  return true;
+}
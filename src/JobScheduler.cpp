@@ -0,0 +1,112 @@
+#include "JobScheduler.h"
+#include "TraceProfiler.h"
+
+// Global instance
+JobScheduler jobScheduler;
+
+JobScheduler::JobScheduler() : nextId(1) {
+  for (Job& job : jobs) {
+    job.id = 0;
+  }
+}
+
+uint16_t JobScheduler::start(const char* name, JobStep step, JobFinish finish, int32_t arg) {
+  for (Job& job : jobs) {
+    if (job.id) {
+      continue;
+    }
+  
+    job.id = nextId;
+    nextId = nextId == UINT16_MAX ? 1 : nextId + 1;
+    job.name = name;
+    job.step = step;
+    job.finish = finish;
+    job.route = discordClient.getReplyRoute();
+    job.state = 0;
+    job.progress = 0;
+    job.arg = arg;
+    job.startedMs = millis();
+    job.wakeAtMs = job.startedMs; // First step runs on the next update
+    Serial.printf("Job #%u started: %s\n", job.id, name);
+    return job.id;
+  }
+  
+  discordClient.beginResponse().contentf("⏳ **Busy**: %u jobs already running. Try again later or use `cancel`.", MAX_JOBS);
+  discordClient.sendResponse();
+  return 0;
+}
+
+void JobScheduler::update() {
+  unsigned long now = millis();
+  for (Job& job : jobs) {
+    if (!job.id || (long)(now - job.wakeAtMs) < 0) {
+      continue;
+    }
+  
+    TRACE_SCOPE(job.name);
+    ReplyRoute previous = discordClient.setReplyRoute(job.route);
+    JobStatus status = job.step(job);
+    if (status != JOB_RUNNING) {
+      end(job, status);
+    }
+    discordClient.setReplyRoute(previous);
+  }
+}
+
+bool JobScheduler::cancel(uint16_t id) {
+  for (Job& job : jobs) {
+    if (job.id != id || id == 0) {
+      continue;
+    }
+  
+    ReplyRoute previous = discordClient.setReplyRoute(job.route);
+    end(job, JOB_CANCELLED);
+    discordClient.setReplyRoute(previous);
+    return true;
+  }
+  return false;
+}
+
+void JobScheduler::end(Job& job, JobStatus status) {
+  Serial.printf("Job #%u %s: %s\n", job.id, job.name,
+                status == JOB_DONE ? "done" : (status == JOB_FAILED ? "failed" : "cancelled"));
+  
+  if (job.finish) {
+    job.finish(job, status);
+  } else if (status == JOB_FAILED) {
+    discordClient.beginResponse().contentf("❌ **Job #%u (`%s`) failed**", job.id, job.name);
+    discordClient.sendResponse();
+  } else if (status == JOB_CANCELLED) {
+    discordClient.beginResponse().contentf("⛔ **Job #%u (`%s`) cancelled**", job.id, job.name);
+    discordClient.sendResponse();
+  }
+  job.id = 0;
+}
+
+const Job* JobScheduler::find(uint16_t id) const {
+  for (const Job& job : jobs) {
+    if (job.id && job.id == id) {
+      return &job;
+    }
+  }
+  return nullptr;
+}
+
+const Job* JobScheduler::findByName(const char* name) const {
+  for (const Job& job : jobs) {
+    if (job.id && strcmp(job.name, name) == 0) {
+      return &job;
+    }
+  }
+  return nullptr;
+}
+
+uint8_t JobScheduler::getActiveCount() const {
+  uint8_t count = 0;
+  for (const Job& job : jobs) {
+    if (job.id) {
+      count++;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,131 @@
+#include "LiveStatus.h"
+#include "DiscordClient.h"
+#include "CommandSystem.h"
+#include "TraceProfiler.h"
+#include <WiFi.h>
+#include <Preferences.h>
+
+// Global instance
+LiveStatus liveStatus;
+
+LiveStatus::LiveStatus()
+  : messageId(0),
+    sentHash(0),
+    pendingHash(0),
+    lastPollMs(0),
+    changedMs(0),
+    dirtySinceMs(0),
+    lastEditMs(0),
+    enabled(false),
+    dirty(false),
+    forcePublish(false),
+    createCount(0),
+    editCount(0),
+    skippedCount(0) {}
+
+void LiveStatus::begin() {
+  Preferences preferences;
+  preferences.begin("discord", true);
+  enabled = preferences.getBool("live_on", false);
+  messageId = preferences.getULong64("live_msg", 0);
+  preferences.end();
+  
+  if (enabled) {
+    Serial.printf("Live status enabled (message %llu)\n", (unsigned long long)messageId);
+  }
+}
+
+void LiveStatus::setEnabled(bool on) {
+  enabled = on;
+  // Publish on the next poll so the user sees the message right away
+  forcePublish = on;
+  save();
+}
+
+void LiveStatus::update() {
+  if (!enabled) return;
+  
+  unsigned long now = millis();
+  if (now - lastPollMs < LIVE_STATUS_POLL_MS) return;
+  lastPollMs = now;
+  
+  TRACE_SCOPE("LiveStatus::update");
+  ResponseBuilder& reply = discordClient.beginResponse();
+  CommandSystem::writeStatusEmbed(reply, "📡 Live Status", false);
+  reply.finish();
+  
+  uint32_t hash = hashPayload(reply.data(), reply.length());
+  if (hash != pendingHash) {
+    pendingHash = hash;
+    changedMs = now;
+  }
+  
+  // A change that reverts before it is published costs nothing
+  bool wasDirty = dirty;
+  dirty = hash != sentHash || messageId == 0;
+  if (!dirty) {
+    forcePublish = false;
+    skippedCount++;
+    return;
+  }
+  if (!wasDirty) {
+    dirtySinceMs = now;
+  }
+  
+  bool settled = now - changedMs >= LIVE_STATUS_DEBOUNCE_MS;
+  bool overdue = now - dirtySinceMs >= LIVE_STATUS_MAX_DELAY_MS;
+  if (!forcePublish && (!(settled || overdue) || now - lastEditMs < LIVE_STATUS_MIN_EDIT_MS)) {
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) return;
+  
+  // Failures also wait a full edit interval before retrying
+  lastEditMs = now;
+  forcePublish = false;
+  if (publish(reply.data(), reply.length())) {
+    sentHash = hash;
+    dirty = false;
+  }
+}
+
+bool LiveStatus::publish(const char* payload, size_t length) {
+  if (messageId != 0) {
+    int httpCode = discordClient.editMessage(messageId, payload, length);
+    if (httpCode / 100 == 2) {
+      editCount++;
+      return true;
+    }
+    if (httpCode != 404 && httpCode != 403) {
+      return false;
+    }
+    // Deleted, or posted through the other send backend: post a new one
+    Serial.println("Live status message is gone, posting a new one");
+    messageId = 0;
+  }
+  
+  if (!discordClient.createMessage(payload, length, messageId)) {
+    return false;
+  }
+  createCount++;
+  save();
+  return true;
+}
+
+void LiveStatus::save() {
+  Preferences preferences;
+  if (!preferences.begin("discord", false)) {
+    return;
+  }
+  preferences.putBool("live_on", enabled);
+  preferences.putULong64("live_msg", messageId);
+  preferences.end();
+}
+
+uint32_t LiveStatus::hashPayload(const char* payload, size_t length) {
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)payload[i]) * 16777619UL;
+  }
+  return hash;
+}
@@ -0,0 +1,96 @@
+#include "LocalControlServer.h"
+#include "CommandSystem.h"
+#include "DiscordClient.h"
+#include "TraceProfiler.h"
+#include "config.h"
+
+// Global instance
+LocalControlServer localControlServer;
+
+LocalControlServer::LocalControlServer()
+  : callerPort(0),
+    commandStartUs(0),
+    running(false) {
+}
+
+void LocalControlServer::begin(uint16_t port) {
+  if (port == 0) {
+    Serial.println("LAN control disabled");
+    return;
+  }
+  // Any LAN host could power the PC or rewrite NVS settings without a key
+  if (LOCAL_CONTROL_KEY[0] == '\0') {
+    Serial.println("LAN control disabled: LOCAL_CONTROL_KEY is empty");
+    return;
+  }
+  
+  running = udp.begin(port);
+  if (running) {
+    Serial.println("LAN control listening on UDP port " + String(port));
+  } else {
+    Serial.println("Failed to start LAN control on UDP port " + String(port));
+  }
+}
+
+void LocalControlServer::update() {
+  if (!running) {
+    return;
+  }
+  
+  // Bound the work per loop so a flood cannot starve the gateway
+  for (int i = 0; i < MAX_PACKETS_PER_UPDATE; i++) {
+    int size = udp.parsePacket();
+    if (size <= 0) {
+      break;
+    }
+    
+    TRACE_SCOPE("LAN command");
+    uint32_t receivedUs = micros();
+    int length = udp.read(packet, MAX_PACKET_SIZE - 1);
+    if (length <= 0) {
+      continue;
+    }
+    commandStartUs = receivedUs;
+    packet[length] = '\0';
+    callerIp = udp.remoteIP();
+    callerPort = udp.remotePort();
+    handlePacket(length);
+    commandStartUs = 0; // Commands without a reply must not leave the timer running
+  }
+}
+
+void LocalControlServer::handlePacket(size_t length) {
+  const char* command = packet;
+  
+  // Shared key: "<key> <command>"; nothing is sent back to unkeyed packets
+  size_t keyLength = strlen(LOCAL_CONTROL_KEY);
+  if (length <= keyLength || strncmp(packet, LOCAL_CONTROL_KEY, keyLength) != 0 || packet[keyLength] != ' ') {
+    Serial.println("LAN control: rejected packet from " + callerIp.toString());
+    return;
+  }
+  command += keyLength + 1;
+  length -= keyLength + 1;
+  
+  Serial.printf("LAN command from %s: %s\n", callerIp.toString().c_str(), command);
+  
+  // The caller's address travels with the route so async jobs can answer later
+  uint64_t caller = ((uint64_t)(uint32_t)callerIp << 16) | callerPort;
+  ReplyRoute previous = discordClient.setReplyRoute({replyToCaller, caller});
+  commandSystem.executeCommand(command, length);
+  discordClient.setReplyRoute(previous);
+}
+
+bool LocalControlServer::replyToCaller(const char* payload, size_t length, uint64_t caller) {
+  LocalControlServer& server = localControlServer;
+  
+  server.udp.beginPacket(IPAddress((uint32_t)(caller >> 16)), (uint16_t)(caller & 0xFFFF));
+  server.udp.write((const uint8_t*)payload, length);
+  bool sent = server.udp.endPacket();
+  
+  // Latency of the first reply, measured from datagram receipt
+  if (server.commandStartUs != 0) {
+    server.commandLatency.add(micros() - server.commandStartUs);
+    server.commandStartUs = 0;
+  }
+  return sent;
+}
@@ -1,4 +1,5 @@
 #include "NeoPixelManager.h"
+#include "TraceProfiler.h"
 
 // Global instance
 NeoPixelManager neoPixelManager;
@@ -8,7 +9,12 @@ NeoPixelManager::NeoPixelManager()
     lastRainbowUpdate(0),
     rainbowStep(0),
     rainbowMode(true),
-    enabled(true) {
+    enabled(true),
+    color(0),
+    flashing(false),
+    flashWasRainbow(false),
+    flashEndMs(0),
+    flashId(0) {
 }
 
 void NeoPixelManager::begin() {
@@ -34,6 +40,11 @@ void NeoPixelManager::begin() {
 }
 
 void NeoPixelManager::update() {
+  TRACE_SCOPE("NeoPixelManager::update");
+  if (flashing && (long)(millis() - flashEndMs) >= 0) {
+    endFlash();
+  }
+  
   if (!enabled) {
     return;
   }
@@ -57,13 +68,16 @@ void NeoPixelManager::update() {
 }
 
 void NeoPixelManager::setColor(uint8_t red, uint8_t green, uint8_t blue) {
+  flashing = false;
   rainbowMode = false;
   enabled = true;
-  strip.setPixelColor(0, strip.Color(red, green, blue));
+  color = strip.Color(red, green, blue);
+  strip.setPixelColor(0, color);
   strip.show();
 }
 
 void NeoPixelManager::setRainbowMode(bool enable) {
+  flashing = false;
   rainbowMode = enable;
   if (enable) {
     enabled = true;
@@ -71,6 +85,7 @@ void NeoPixelManager::setRainbowMode(bool enable) {
 }
 
 void NeoPixelManager::setEnabled(bool enable) {
+  flashing = false;
   enabled = enable;
   if (!enable) {
     rainbowMode = false;
@@ -79,18 +94,48 @@ void NeoPixelManager::setEnabled(bool enable) {
   }
 }
 
-void NeoPixelManager::flashColor(uint8_t red, uint8_t green, uint8_t blue, int duration) {
-  bool wasRainbow = rainbowMode;
+void NeoPixelManager::setBrightness(uint8_t brightness) {
+  strip.setBrightness(brightness);
+  // setBrightness rescales the stored pixels (level 0 zeroes them), so repaint
+  // the static color; rainbow and flash endings repaint on their own
+  if (enabled && !rainbowMode && !flashing) {
+    strip.setPixelColor(0, color);
+  }
+  strip.show();
+}
+
+uint16_t NeoPixelManager::flashColor(uint8_t red, uint8_t green, uint8_t blue, int duration) {
+  // A flash over a flash keeps the state from before the first one
+  if (!flashing) {
+    flashWasRainbow = rainbowMode;
+  }
+  flashing = true;
   rainbowMode = false;
+  flashEndMs = millis() + duration;
   
   strip.setPixelColor(0, strip.Color(red, green, blue));
   strip.show();
-  delay(duration);
   
-  if (wasRainbow) {
+  // 0 is never issued, so it cannot match a later flash
+  if (++flashId == 0) {
+    flashId = 1;
+  }
+  return flashId;
+}
+
+void NeoPixelManager::cancelFlash(uint16_t id) {
+  if (flashing && id == flashId) {
+    endFlash();
+  }
+}
+
+void NeoPixelManager::endFlash() {
+  flashing = false;
+  if (flashWasRainbow) {
     rainbowMode = true;
   } else {
-    // Return to previous color (you might want to store previous state)
+    // Back to the previous static color, or dark if the LED was off
+    strip.setPixelColor(0, enabled ? color : 0);
     strip.show();
   }
 }
@@ -0,0 +1,202 @@
+#include "ResponseBuilder.h"
+#include <stdarg.h>
+
+// Nesting depths: 1 = root object, 2 = content string or embeds array,
+// 3 = embed object, 4 = fields array, 5 = field object, 6 = field string
+static const uint8_t ROOT_DEPTH = 1;
+static const uint8_t EMBEDS_DEPTH = 2;
+static const uint8_t EMBED_DEPTH = 3;
+static const uint8_t FIELDS_DEPTH = 4;
+
+ResponseBuilder::ResponseBuilder() {
+  begin();
+}
+
+ResponseBuilder& ResponseBuilder::begin() {
+  used = 0;
+  depth = 0;
+  rootMembers = 0;
+  embedCount = 0;
+  fieldCount = 0;
+  contentOpen = false;
+  embedsOpen = false;
+  overflow = false;
+  open("{", '}');
+  return *this;
+}
+
+bool ResponseBuilder::raw(const char* text) {
+  size_t length = strlen(text);
+  if (overflow || used + length > BUFFER_SIZE - CLOSING_RESERVE) {
+    overflow = true;
+    return false;
+  }
+  memcpy(buffer + used, text, length);
+  used += length;
+  return true;
+}
+
+bool ResponseBuilder::open(const char* text, char closer) {
+  if (depth >= MAX_DEPTH || !raw(text)) {
+    return false;
+  }
+  closers[depth++] = closer;
+  return true;
+}
+
+void ResponseBuilder::close() {
+  // Always fits: CLOSING_RESERVE covers every open level
+  buffer[used++] = closers[--depth];
+}
+
+void ResponseBuilder::closeTo(uint8_t targetDepth) {
+  while (depth > targetDepth) {
+    close();
+  }
+}
+
+void ResponseBuilder::escaped(const char* text) {
+  while (*text && !overflow) {
+    unsigned char c = (unsigned char)*text;
+    char escape[8];
+    const char* source = escape;
+    size_t length = 2;
+    size_t consumed = 1;
+    
+    if (c == '"' || c == '\\') {
+      escape[0] = '\\';
+      escape[1] = c;
+    } else if (c == '\n') {
+      memcpy(escape, "\\n", 2);
+    } else if (c == '\r') {
+      memcpy(escape, "\\r", 2);
+    } else if (c == '\t') {
+      memcpy(escape, "\\t", 2);
+    } else if (c < 0x20) {
+      length = snprintf(escape, sizeof(escape), "\\u%04x", c);
+    } else {
+      // Copy whole UTF-8 sequences so truncation never splits a character
+      size_t sequence = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+      size_t available = 1;
+      while (available < sequence && text[available]) {
+        available++;
+      }
+      source = text;
+      length = available;
+      consumed = available;
+    }
+    
+    if (used + length > BUFFER_SIZE - CLOSING_RESERVE) {
+      overflow = true;
+      break;
+    }
+    memcpy(buffer + used, source, length);
+    used += length;
+    text += consumed;
+  }
+}
+
+void ResponseBuilder::stringValue(const char* keyPrefix, const char* text) {
+  if (open(keyPrefix, '"')) {
+    escaped(text);
+    close();
+  }
+}
+
+ResponseBuilder& ResponseBuilder::content(const char* text) {
+  if (!contentOpen) {
+    if (embedsOpen) {
+      Serial.println("ResponseBuilder: content must be written before embeds");
+      return *this;
+    }
+    closeTo(ROOT_DEPTH);
+    if (!open(rootMembers ? ",\"content\":\"" : "\"content\":\"", '"')) {
+      return *this;
+    }
+    contentOpen = true;
+    rootMembers++;
+  }
+  escaped(text);
+  return *this;
+}
+
+ResponseBuilder& ResponseBuilder::contentf(const char* format, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  return content(text);
+}
+
+ResponseBuilder& ResponseBuilder::beginEmbed(const char* title, uint32_t color) {
+  if (contentOpen) {
+    closeTo(ROOT_DEPTH);
+    contentOpen = false;
+  }
+  if (!embedsOpen) {
+    closeTo(ROOT_DEPTH);
+    if (!open(rootMembers ? ",\"embeds\":[" : "\"embeds\":[", ']')) {
+      return *this;
+    }
+    embedsOpen = true;
+    rootMembers++;
+  }
+  
+  closeTo(EMBEDS_DEPTH);
+  if (!open(embedCount ? ",{" : "{", '}')) {
+    return *this;
+  }
+  embedCount++;
+  fieldCount = 0;
+  
+  char colorMember[24];
+  snprintf(colorMember, sizeof(colorMember), "\"color\":%lu", (unsigned long)(color & 0xFFFFFF));
+  raw(colorMember);
+  stringValue(",\"title\":\"", title);
+  return *this;
+}
+
+ResponseBuilder& ResponseBuilder::embedDescription(const char* text) {
+  if (depth == EMBED_DEPTH) {
+    stringValue(",\"description\":\"", text);
+  }
+  return *this;
+}
+
+ResponseBuilder& ResponseBuilder::field(const char* name, const char* value, bool inlineField) {
+  if (depth == EMBED_DEPTH && open(",\"fields\":[", ']')) {
+    fieldCount = 0;
+  }
+  if (depth != FIELDS_DEPTH || !open(fieldCount ? ",{" : "{", '}')) {
+    return *this;
+  }
+  fieldCount++;
+  
+  stringValue("\"name\":\"", name);
+  stringValue(",\"value\":\"", value);
+  if (inlineField) {
+    raw(",\"inline\":true");
+  }
+  closeTo(FIELDS_DEPTH);
+  return *this;
+}
+
+ResponseBuilder& ResponseBuilder::endEmbed() {
+  if (embedsOpen) {
+    closeTo(EMBEDS_DEPTH);
+  }
+  return *this;
+}
+
+const char* ResponseBuilder::finish() {
+  closeTo(0);
+  buffer[used] = '\0';
+  contentOpen = false;
+  embedsOpen = false;
+  
+  if (overflow) {
+    Serial.println("ResponseBuilder: reply truncated to fit send buffer");
+  }
+  return buffer;
+}
@@ -0,0 +1,136 @@
+#include "SendBackend.h"
+#include "TraceProfiler.h"
+
+// Response headers HTTPClient keeps for rate-limit tracking
+static const char* rateLimitHeaders[] = {"X-RateLimit-Remaining", "X-RateLimit-Reset-After", "Retry-After"};
+
+SendBackend::SendBackend(const char* name) : client(nullptr), name(name) {
+  bucket.remaining = -1;
+  bucket.resetAtMs = 0;
+  bucket.requestCount = 0;
+  bucket.limitedCount = 0;
+  bucket.deferredCount = 0;
+}
+
+int SendBackend::request(const char* method, const String& url, const char* authorization,
+                         const char* payload, size_t length, String* body) {
+  if (!client) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  
+  if (!isReady()) {
+    Serial.printf("Rate limit: %s bucket empty for %ld ms, deferring %s\n", name,
+                  (long)(bucket.resetAtMs - millis()), method);
+    bucket.deferredCount++;
+    return RATE_LIMITED;
+  }
+  
+  TRACE_SCOPE("REST send");
+  Serial.printf("Sending %s via %s to: %s\n", method, name, url.c_str());
+  Serial.print("JSON Payload: ");
+  Serial.write(payload, length);
+  Serial.println();
+  
+  HTTPClient http;
+  http.begin(*client, url);
+  if (authorization) {
+    http.addHeader("Authorization", authorization);
+  }
+  http.addHeader("Content-Type", "application/json");
+  http.setTimeout(10000);
+  http.collectHeaders(rateLimitHeaders, 3);
+  
+  int httpCode = http.sendRequest(method, (uint8_t*)payload, length);
+  bucket.requestCount++;
+  updateBucket(http, httpCode);
+  
+  Serial.print("HTTP Response Code: ");
+  Serial.println(httpCode);
+  
+  if (httpCode / 100 == 2) {
+    Serial.println("Message sent successfully");
+    if (body) {
+      *body = http.getString();
+    }
+  } else if (httpCode > 0) {
+    // Only read the body when it is needed for diagnostics
+    Serial.print("Discord API returned error code: ");
+    Serial.println(httpCode);
+    Serial.println("Error response: " + http.getString());
+  } else {
+    Serial.print("HTTP request failed with code: ");
+    Serial.println(httpCode);
+  }
+  
+  http.end();
+  return httpCode;
+}
+
+bool SendBackend::isReady() const {
+  return bucket.remaining != 0 || (long)(bucket.resetAtMs - millis()) <= 0;
+}
+
+void SendBackend::updateBucket(HTTPClient& http, int httpCode) {
+  if (httpCode <= 0) {
+    return;
+  }
+  
+  String remaining = http.header("X-RateLimit-Remaining");
+  String resetAfter = http.header("X-RateLimit-Reset-After");
+  if (httpCode == 429) {
+    bucket.limitedCount++;
+    bucket.remaining = 0;
+    if (resetAfter.length() == 0) {
+      resetAfter = http.header("Retry-After");
+    }
+  } else if (remaining.length() > 0) {
+    bucket.remaining = remaining.toInt();
+  }
+  if (resetAfter.length() > 0) {
+    bucket.resetAtMs = millis() + (unsigned long)(resetAfter.toFloat() * 1000.0f);
+  }
+}
+
+void BotSendBackend::begin(WiFiClient& client, const String& messagesUrl, const String& authorizationHeader) {
+  this->client = &client;
+  this->messagesUrl = messagesUrl;
+  this->authorizationHeader = authorizationHeader;
+}
+
+int BotSendBackend::post(const char* payload, size_t length, String* body) {
+  return request("POST", messagesUrl, authorizationHeader.c_str(), payload, length, body);
+}
+
+int BotSendBackend::edit(uint64_t messageId, const char* payload, size_t length) {
+  char path[24];
+  snprintf(path, sizeof(path), "/%llu", (unsigned long long)messageId);
+  return request("PATCH", messagesUrl + path, authorizationHeader.c_str(), payload, length, nullptr);
+}
+
+void WebhookSendBackend::begin(WiFiClient& client, const String& webhookUrl, bool wait) {
+  this->client = &client;
+  this->wait = wait;
+  
+  // Split off any query so it can follow /messages/{id} on edits
+  int query = webhookUrl.indexOf('?');
+  String base = query >= 0 ? webhookUrl.substring(0, query) : webhookUrl;
+  messagesQuery = query >= 0 ? webhookUrl.substring(query) : String();
+  
+  postUrl = webhookUrl;
+  waitPostUrl = webhookUrl + (query >= 0 ? "&wait=true" : "?wait=true");
+  messagesUrl = base.length() > 0 ? base + "/messages/" : String();
+}
+
+int WebhookSendBackend::post(const char* payload, size_t length, String* body) {
+  // Discord only returns the created message when asked to wait for it
+  if (wait || body) {
+    return request("POST", waitPostUrl, nullptr, payload, length, body);
+  }
+  return request("POST", postUrl, nullptr, payload, length, nullptr);
+}
+
+int WebhookSendBackend::edit(uint64_t messageId, const char* payload, size_t length) {
+  char id[21];
+  snprintf(id, sizeof(id), "%llu", (unsigned long long)messageId);
+  return request("PATCH", messagesUrl + id + messagesQuery, nullptr, payload, length, nullptr);
+}
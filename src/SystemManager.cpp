@@ -2,6 +2,11 @@
 #include "DiscordClient.h"
 #include "NeoPixelManager.h"
 #include "CommandSystem.h"
+#include "LocalControlServer.h"
+#include "TraceProfiler.h"
+#include "GuildCache.h"
+#include "JobScheduler.h"
+#include "LiveStatus.h"
 #include "config.h"
 #include <WiFi.h>
 
@@ -16,7 +21,12 @@ void SystemManager::begin() {
   
   initializeComponents();
   initializeWiFi();
+  
+  // Needs WiFi: /gateway/bot supplies max_concurrency before the first identify
+  discordClient.begin();
+  liveStatus.begin();
   registerCommands();
+  localControlServer.begin(LOCAL_CONTROL_PORT);
   
   initialized = true;
   Serial.println("System initialization complete!");
@@ -28,8 +38,18 @@ void SystemManager::begin() {
 void SystemManager::update() {
   if (!initialized) return;
   
+  TRACE_SCOPE("SystemManager::update");
   neoPixelManager.update();
   discordClient.update();
+  jobScheduler.update();
+  liveStatus.update();
+  localControlServer.update();
+  
+  // Press 't' in the serial monitor to dump a trace
+  if (Serial.available() > 0 && Serial.read() == 't') {
+    traceProfiler.startExport(Serial);
+  }
+  traceProfiler.update();
 }
 
 String SystemManager::getStatusString() const {
@@ -49,16 +69,56 @@ void SystemManager::initializeWiFi() {
   Serial.println("WiFi connected!");
   Serial.print("IP address: ");
   Serial.println(WiFi.localIP());
+  
+  // Wall-clock time paces sharded IDENTIFYs and measures command latency
+  configTime(0, 0, "pool.ntp.org");
 }
 
 void SystemManager::initializeComponents() {
   // Initialize all components
   neoPixelManager.begin();
-  discordClient.begin();
+  guildCache.begin();
   
   Serial.println("All components initialized");
 }
 
+// Argument specs for typed commands (must outlive registration)
+static const ArgSpec colorArgs[] = {
+  {"color", ARG_COLOR, 0, 0, nullptr, false, false},
+};
+
+static const ArgSpec brightnessArgs[] = {
+  {"level", ARG_INT, 0, 255, nullptr, false, false},
+};
+
+static const ArgSpec traceArgs[] = {
+  {"threshold_ms", ARG_INT, 1, 60000, nullptr, true, false},
+};
+
+static const ArgSpec shardArgs[] = {
+  {"id", ARG_INT, 0, 1023, nullptr, true, false},
+  {"count", ARG_INT, 1, 1024, nullptr, true, true},
+};
+
+static const ArgSpec cancelArgs[] = {
+  {"job", ARG_INT, 1, 65535, nullptr, true, false},
+};
+
+static const char* const onOffChoices[] = {"on", "off", nullptr};
+static const ArgSpec liveStatusArgs[] = {
+  {"state", ARG_ENUM, 0, 0, onOffChoices, true, false},
+};
+
+static const char* const backendChoices[] = {"bot", "webhook", nullptr};
+static const ArgSpec sendViaArgs[] = {
+  {"backend", ARG_ENUM, 0, 0, backendChoices, true, false},
+};
+
+static const ArgSpec flashArgs[] = {
+  {"color", ARG_COLOR, 0, 0, nullptr, false, false},
+  {"duration", ARG_DURATION, 50, 5000, nullptr, true, false},
+};
+
 void SystemManager::registerCommands() {
   // Register all available commands
   commandSystem.addCommand("status", "Check system status", CommandSystem::statusCommand);
@@ -69,8 +129,24 @@ void SystemManager::registerCommands() {
   commandSystem.addCommand("green", "Set LED to green", CommandSystem::greenCommand);
   commandSystem.addCommand("blue", "Set LED to blue", CommandSystem::blueCommand);
   commandSystem.addCommand("white", "Set LED to white", CommandSystem::whiteCommand);
+  commandSystem.addCommand("color", "Set LED to any color", colorArgs, 1, CommandSystem::colorCommand);
+  commandSystem.addCommand("brightness", "Set LED brightness", brightnessArgs, 1, CommandSystem::brightnessCommand);
+  commandSystem.addCommand("flash", "Flash LED with a color", flashArgs, 2, CommandSystem::flashCommand);
   commandSystem.addCommand("off", "Turn off LED", CommandSystem::offCommand);
+  commandSystem.addCommand("cancel", "Cancel a running job (lists jobs without an id)", cancelArgs, 1, CommandSystem::cancelCommand);
+  commandSystem.addCommand("live_status", "Keep one status message updated in place", liveStatusArgs, 1, CommandSystem::liveStatusCommand);
+  commandSystem.addCommand("send_via", "Show or choose how replies are sent (bot or webhook)", sendViaArgs, 1, CommandSystem::sendViaCommand);
+  commandSystem.addCommand("latency", "Compare LAN and Discord command latency", CommandSystem::latencyCommand);
+  commandSystem.addCommand("shard", "Show or store this board's gateway shard", shardArgs, 2, CommandSystem::shardCommand);
+  commandSystem.addCommand("trace", "Dump loop trace to serial, optionally set stall threshold", traceArgs, 1, CommandSystem::traceCommand);
   commandSystem.addCommand("help", "Show available commands", CommandSystem::helpCommand);
   
+  // Throttle tokens per use (default 1): big replies cost more, cancel is always allowed
+  commandSystem.setCommandCost("status", 2);
+  commandSystem.setCommandCost("help", 2);
+  commandSystem.setCommandCost("trace", 3);
+  commandSystem.setCommandCost("cancel", 0);
+  commandSystem.buildStaticReplies();
+  
   Serial.println("Commands registered successfully");
 }
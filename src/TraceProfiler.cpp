@@ -0,0 +1,132 @@
+#include "TraceProfiler.h"
+
+// Global instance
+TraceProfiler traceProfiler;
+
+TraceProfiler::TraceProfiler()
+  : head(0),
+    count(0),
+    stallHead(0),
+    stallEventCount(0),
+    exportOut(nullptr),
+    exportIndex(0),
+    depth(0),
+    stalledChildren(0),
+    stallThresholdUs(TRACE_STALL_THRESHOLD_MS * 1000UL),
+    stallCount(0),
+    lastStallName(nullptr),
+    lastStallUs(0) {
+}
+
+uint8_t TraceProfiler::enter() {
+  uint8_t scopeDepth = depth;
+  if (depth < MAX_DEPTH) {
+    depth++;
+  }
+  return scopeDepth;
+}
+
+void TraceProfiler::exit(const char* name, uint32_t startUs, uint8_t scopeDepth) {
+  uint32_t durationUs = micros() - startUs;
+  depth = scopeDepth;
+  
+  // Only the innermost stalled scope is flagged; its parents are implied
+  uint32_t childBit = 1UL << scopeDepth;
+  bool childStalled = stalledChildren & childBit;
+  stalledChildren &= ~childBit;
+  
+  bool stall = durationUs >= stallThresholdUs;
+  if (stall) {
+    if (scopeDepth > 0) {
+      stalledChildren |= 1UL << (scopeDepth - 1);
+    }
+    if (!childStalled) {
+      stallCount++;
+      lastStallName = name;
+      lastStallUs = durationUs;
+      Serial.printf("Loop stall: %s took %lu ms (threshold %lu ms)\n",
+                    name, (unsigned long)(durationUs / 1000UL), (unsigned long)getStallThreshold());
+    }
+  }
+  
+  // Buffers are frozen while they are being written out
+  if (exportOut) {
+    return;
+  }
+  
+  TraceEvent event = {name, startUs, durationUs, scopeDepth, stall && !childStalled};
+  if (stall) {
+    // Every scope over the threshold, so the stalled call chain survives
+    stallEvents[stallHead] = event;
+    stallHead = (stallHead + 1) % MAX_STALL_EVENTS;
+    if (stallEventCount < MAX_STALL_EVENTS) {
+      stallEventCount++;
+    }
+  }
+  
+  events[head] = event;
+  head = (head + 1) % MAX_EVENTS;
+  if (count < MAX_EVENTS) {
+    count++;
+  }
+}
+
+bool TraceProfiler::startExport(Print& out) {
+  if (exportOut) {
+    return false;
+  }
+  
+  exportOut = &out;
+  exportIndex = 0;
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  return true;
+}
+
+void TraceProfiler::update() {
+  if (!exportOut) {
+    return;
+  }
+  
+  // Stall buffer first (tid 2), then the ring (tid 1). At least one event per
+  // loop, more while the serial TX buffer has room, so the loop never waits
+  // for the whole dump.
+  int total = stallEventCount + count;
+  bool wrote = false;
+  while (exportIndex < total && (!wrote || exportOut->availableForWrite() >= EXPORT_EVENT_BYTES)) {
+    const TraceEvent& event = exportEvent(exportIndex);
+    exportOut->printf("%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%d",
+                      exportIndex ? "," : "", event.name, event.stall ? "stall" : "loop",
+                      (unsigned long)event.startUs, (unsigned long)event.durationUs,
+                      exportIndex < stallEventCount ? 2 : 1);
+    if (event.stall) {
+      exportOut->print(",\"args\":{\"stall\":true}");
+    }
+    exportOut->print("}");
+    exportIndex++;
+    wrote = true;
+  }
+  
+  if (exportIndex >= total) {
+    exportOut->println("]}");
+    exportOut = nullptr;
+  }
+}
+
+const TraceEvent& TraceProfiler::exportEvent(int index) const {
+  if (index < stallEventCount) {
+    int first = (stallHead - stallEventCount + MAX_STALL_EVENTS) % MAX_STALL_EVENTS;
+    return stallEvents[(first + index) % MAX_STALL_EVENTS];
+  }
+  int first = (head - count + MAX_EVENTS) % MAX_EVENTS;
+  return events[(first + index - stallEventCount) % MAX_EVENTS];
+}
+
+TraceScope::TraceScope(const char* scopeName)
+  : name(scopeName),
+    startUs(micros()),
+    depth(traceProfiler.enter()) {
+}
+
+TraceScope::~TraceScope() {
+  traceProfiler.exit(name, startUs, depth);
+}
@@ -0,0 +1,1132 @@
+#!/usr/bin/env python3
+"""Local Discord gateway and REST simulator for load testing the ESP32 bot.
+
+Implements the subset of the Discord API that DiscordClient uses:
+
+  * Gateway: HELLO, IDENTIFY/RESUME, heartbeat ACK, dispatch (READY,
+    RESUMED, GUILD_CREATE, MESSAGE_CREATE) and opcodes 7 (reconnect) and
+    9 (invalid session).
+  * REST: GET /api/v10/gateway, GET /api/v10/gateway/bot,
+    POST /api/v*/channels/{id}/messages and
+    PATCH /api/v*/channels/{id}/messages/{message_id} (404 for messages the
+    simulator never created).
+  * Webhooks: POST /api/webhooks/{id}/{token} (?wait=true returns the
+    message, otherwise 204) and PATCH .../messages/{message_id}, with a
+    rate-limit bucket separate from the bot's (--bot-bucket, --webhook-bucket).
+  * GUILD_CREATE payloads sized like real ones (--guild-channels,
+    --guild-roles), a few hundred KB by default.
+  * Sharding: IDENTIFY shard validation, per-bucket identify rate limits
+    (shard_id % max_concurrency) and guild events routed to the owning
+    shard by (guild_id >> 22) % shard_count.
+
+Point the device at it by setting DISCORD_SIMULATOR_HOST/PORT in
+src/config.cpp. Only the Python standard library is required.
+
+Examples:
+  # Serve a gateway and drive 2000 MESSAGE_CREATE/s for 30 s
+  python3 tools/discord_sim.py serve --rate 2000 --duration 30
+
+  # Inject REST latency, 5% 429s and a disconnect roughly every 60 s
+  python3 tools/discord_sim.py serve --rest-latency-ms 80 --rate-limit-ratio 0.05 \\
+      --disconnect-every 60
+
+  # Record a real gateway session, then replay it against the device
+  python3 tools/discord_sim.py capture --token "$BOT_TOKEN" --seconds 120 -o capture.jsonl
+  python3 tools/discord_sim.py serve --replay capture.jsonl --replay-speed 10
+
+  # Fleet of 4 boards, each identifying as one shard of 4
+  python3 tools/discord_sim.py serve --shards 4 --max-concurrency 1 --guilds 64 --rate 2000
+
+  # Shard routing check with 1, 2 and 4 emulated clients (no firmware involved)
+  python3 tools/discord_sim.py shard-bench --max-shards 4 --client-cost-ms 5
+
+  # Reply throughput via the bot API vs. a webhook (5/5 s vs. 5/2 s buckets)
+  python3 tools/discord_sim.py send-bench --rate 10 --duration 10
+
+  # Normal traffic from 10 users while one user spams 200 commands every 10 s
+  python3 tools/discord_sim.py serve --rate 0.1 --authors 10 --duration 60 \\
+      --abuse-burst 200 --abuse-every 10
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import ssl
+import struct
+import sys
+import time
+from collections import deque
+from urllib.parse import parse_qs, urlsplit
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+DISCORD_EPOCH_MS = 1420070400000
+IDENTIFY_WINDOW_MS = 5000
+DEFERRED_REPLY_SLOTS = 4  # Matches DEFERRED_REPLY_SLOTS in DiscordClient.h
+EMULATED_WEBHOOK = "200000000000000002/emulated-token"
+# Simulated guilds get consecutive snowflake timestamps so they spread evenly over shards
+GUILD_TIMESTAMP_BASE = 1 << 36
+
+OP_DISPATCH = 0
+OP_HEARTBEAT = 1
+OP_IDENTIFY = 2
+OP_RESUME = 6
+OP_RECONNECT = 7
+OP_INVALID_SESSION = 9
+OP_HELLO = 10
+OP_HEARTBEAT_ACK = 11
+
+
+def identify_allowed(shard_id, shard_count, max_concurrency, epoch_ms):
+    """DiscordClient::isIdentifyAllowed with a synced clock: wave w may
+    identify in the first window (less 1 s) of slot w of two windows."""
+    waves = (shard_count + max_concurrency - 1) // max_concurrency
+    if waves <= 1:
+        return True
+    slot_ms = 2 * IDENTIFY_WINDOW_MS
+    return (epoch_ms // slot_ms) % waves == shard_id // max_concurrency and \
+        epoch_ms % slot_ms < IDENTIFY_WINDOW_MS - 1000
+
+
+def now_ms():
+    return time.monotonic() * 1000.0
+
+
+class SnowflakeGenerator:
+    def __init__(self):
+        self.increment = 0
+
+    def next(self):
+        self.increment = (self.increment + 1) & 0xFFF
+        timestamp = int(time.time() * 1000) - DISCORD_EPOCH_MS
+        return str((timestamp << 22) | (1 << 17) | self.increment)
+
+
+# --- Minimal RFC 6455 framing ------------------------------------------------
+
+class WebSocketClosed(Exception):
+    pass
+
+
+async def ws_read_message(reader, writer, masked_peer):
+    """Returns the next text payload, answering pings transparently."""
+    fragments = []
+    while True:
+        header = await reader.readexactly(2)
+        fin = header[0] & 0x80
+        opcode = header[0] & 0x0F
+        length = header[1] & 0x7F
+        if length == 126:
+            length = struct.unpack("!H", await reader.readexactly(2))[0]
+        elif length == 127:
+            length = struct.unpack("!Q", await reader.readexactly(8))[0]
+        mask = await reader.readexactly(4) if header[1] & 0x80 else None
+        payload = await reader.readexactly(length)
+        if mask:
+            payload = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+
+        if opcode == 0x8:
+            raise WebSocketClosed(payload[2:].decode(errors="replace"))
+        if opcode == 0x9:
+            ws_write_frame(writer, 0xA, payload, masked_peer)
+            continue
+        if opcode == 0xA:
+            continue
+
+        fragments.append(payload)
+        if fin:
+            return b"".join(fragments).decode()
+
+
+def ws_write_frame(writer, opcode, payload, masked):
+    header = bytearray([0x80 | opcode])
+    mask_bit = 0x80 if masked else 0
+    length = len(payload)
+    if length < 126:
+        header.append(mask_bit | length)
+    elif length < 65536:
+        header.append(mask_bit | 126)
+        header += struct.pack("!H", length)
+    else:
+        header.append(mask_bit | 127)
+        header += struct.pack("!Q", length)
+    if masked:
+        mask = os.urandom(4)
+        header += mask
+        payload = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+    writer.write(bytes(header) + payload)
+
+
+def ws_close(writer, code, reason, masked=False):
+    ws_write_frame(writer, 0x8, struct.pack("!H", code) + reason.encode(), masked)
+
+
+# --- Statistics --------------------------------------------------------------
+
+class Stats:
+    def __init__(self):
+        self.identifies = 0
+        self.identify_rate_limited = 0
+        self.resumes = 0
+        self.disconnects = 0
+        self.reset()
+
+    def reset(self):
+        self.bucket_requests = {}
+        self.bucket_limited = {}
+        self.live_posts = 0
+        self.live_edits = 0
+        self.live_unchanged_edits = 0
+        self.abuse_sent = 0
+        self.abuse_replies = 0
+        self.slow_down_replies = 0
+        self.started = now_ms()
+        self.finished = None
+        self.dispatched = 0
+        self.not_delivered = 0
+        self.replies = 0
+        self.replies_in_window = 0
+        self.unmatched_replies = 0
+        self.rate_limited = 0
+        self.latencies = []
+        # Per shard: MESSAGE_CREATE send times, matched FIFO against that
+        # board's outbound POSTs since every command produces one reply.
+        self.pending = {}
+        self.shard_dispatched = {}
+        self.shard_replies = {}
+
+    def pending_count(self):
+        return sum(len(queue) for queue in self.pending.values())
+
+    def on_dispatch(self, shard=0):
+        self.dispatched += 1
+        self.shard_dispatched[shard] = self.shard_dispatched.get(shard, 0) + 1
+        self.pending.setdefault(shard, deque()).append(now_ms())
+
+    def on_reply(self, shard=0, content="", abuse_marker=None):
+        # Replies to the spammer and throttle notices are not part of the FIFO
+        if "Slow down" in content:
+            self.slow_down_replies += 1
+            return
+        if abuse_marker and abuse_marker in content:
+            self.abuse_replies += 1
+            return
+        self.replies += 1
+        if self.finished is None:
+            self.replies_in_window += 1
+        self.shard_replies[shard] = self.shard_replies.get(shard, 0) + 1
+        queue = self.pending.get(shard)
+        if queue:
+            self.latencies.append(now_ms() - queue.popleft())
+        else:
+            self.unmatched_replies += 1
+
+    def throughput(self):
+        elapsed = max((self.finished or now_ms()) - self.started, 1.0) / 1000.0
+        return self.replies_in_window / elapsed
+
+    def percentile(self, p):
+        latencies = sorted(self.latencies)
+        if not latencies:
+            return float("nan")
+        return latencies[min(len(latencies) - 1, int(p / 100.0 * len(latencies)))]
+
+    def report(self, out=sys.stdout):
+        # Rates are computed over the load window, not the drain period
+        elapsed = max((self.finished or now_ms()) - self.started, 1.0) / 1000.0
+        percentile = self.percentile
+
+        print("=== Simulator report ===", file=out)
+        print(f"Load window:        {elapsed:.1f} s", file=out)
+        print(f"MESSAGE_CREATE:     {self.dispatched} sent "
+              f"({self.dispatched / elapsed:.0f}/s), {self.not_delivered} not delivered", file=out)
+        print(f"Replies:            {self.replies} ({self.throughput():.0f}/s during load), "
+              f"{self.unmatched_replies} unmatched", file=out)
+        print(f"Dropped commands:   {self.pending_count() + self.not_delivered}", file=out)
+        print(f"Command latency ms: p50={percentile(50):.1f} p90={percentile(90):.1f} "
+              f"p99={percentile(99):.1f} max={percentile(100):.1f} (FIFO-matched)", file=out)
+        print(f"429 responses:      {self.rate_limited}", file=out)
+        if "webhook" in self.bucket_requests:
+            print("Send backends:      " + ", ".join(
+                f"{name} {count} requests ({self.bucket_limited.get(name, 0)} limited)"
+                for name, count in sorted(self.bucket_requests.items())), file=out)
+        if self.live_posts or self.live_edits:
+            print(f"Live status:        {self.live_posts} posted, {self.live_edits} edits "
+                  f"({self.live_unchanged_edits} unchanged)", file=out)
+        if self.abuse_sent:
+            print(f"Abuse bursts:       {self.abuse_sent} spam commands, {self.abuse_replies} answered, "
+                  f"{self.slow_down_replies} slow-down replies", file=out)
+        print(f"Sessions:           {self.identifies} identify ({self.identify_rate_limited} rate limited), "
+              f"{self.resumes} resume, {self.disconnects} forced disconnects", file=out)
+        if len(self.shard_dispatched) > 1:
+            for shard in sorted(self.shard_dispatched):
+                print(f"  Shard {shard}: {self.shard_dispatched[shard]} sent, "
+                      f"{self.shard_replies.get(shard, 0)} replies", file=out)
+
+
+# --- Simulator ---------------------------------------------------------------
+
+class RateBucket:
+    """Fixed-window REST rate limit, one per send backend ("5/5" = 5 requests
+    per 5 s, empty = unlimited), reported through X-RateLimit-* headers."""
+
+    def __init__(self, bucket_id, spec):
+        limit, _, seconds = (spec or "0").partition("/")
+        self.bucket_id = bucket_id
+        self.limit = int(limit)
+        self.window = float(seconds or 1)
+        self.remaining = self.limit
+        self.reset_at = 0.0
+
+    def take(self):
+        if not self.limit:
+            return True
+        now = time.monotonic()
+        if now >= self.reset_at:
+            self.remaining = self.limit
+            self.reset_at = now + self.window
+        if self.remaining == 0:
+            return False
+        self.remaining -= 1
+        return True
+
+    def reset_after(self):
+        return max(self.reset_at - time.monotonic(), 0.0) if self.limit else 1.0
+
+    def headers(self):
+        return {
+            "X-RateLimit-Remaining": str(self.remaining if self.limit else 4),
+            "X-RateLimit-Reset-After": f"{self.reset_after():.3f}",
+            "X-RateLimit-Bucket": self.bucket_id,
+        }
+
+
+class GatewaySession:
+    def __init__(self, sim, reader, writer):
+        self.sim = sim
+        self.reader = reader
+        self.writer = writer
+        self.sequence = 0
+        self.session_id = None
+        self.shard = 0
+        self.peer_host = (writer.get_extra_info("peername") or ("?",))[0]
+        self.ready = False
+        self.closed = False
+
+    async def send(self, payload):
+        if self.closed:
+            return False
+        data = json.dumps(payload, separators=(",", ":")).encode()
+        ws_write_frame(self.writer, 0x1, data, masked=False)
+        self.sim.record("send", payload)
+        try:
+            # Like the real gateway, don't pace dispatches to a slow client
+            # until its socket buffer is badly backed up
+            if self.writer.transport.get_write_buffer_size() > (1 << 20):
+                await self.writer.drain()
+        except ConnectionError:
+            self.closed = True
+            return False
+        return True
+
+    async def dispatch(self, event, data):
+        self.sequence += 1
+        return await self.send({"op": OP_DISPATCH, "t": event, "s": self.sequence, "d": data})
+
+    async def run(self):
+        await self.send({"op": OP_HELLO, "d": {"heartbeat_interval": self.sim.args.heartbeat_ms}})
+        try:
+            while not self.closed:
+                message = await ws_read_message(self.reader, self.writer, masked_peer=False)
+                payload = json.loads(message)
+                self.sim.record("recv", payload)
+                await self.handle(payload)
+        except (asyncio.IncompleteReadError, ConnectionError, WebSocketClosed):
+            pass
+        finally:
+            self.closed = True
+            self.sim.sessions.discard(self)
+
+    async def handle(self, payload):
+        op = payload.get("op")
+        if op == OP_HEARTBEAT:
+            await self.send({"op": OP_HEARTBEAT_ACK})
+        elif op == OP_IDENTIFY:
+            await self.identify(payload.get("d") or {})
+        elif op == OP_RESUME:
+            data = payload.get("d") or {}
+            if data.get("session_id") in self.sim.resumable:
+                self.sim.stats.resumes += 1
+                self.session_id = data["session_id"]
+                self.shard = self.sim.resumable[self.session_id][1]
+                self.sequence = int(data.get("seq") or 0)
+                self.sim.shard_by_host[self.peer_host] = self.shard
+                await self.dispatch("RESUMED", {})
+                self.ready = True
+            else:
+                await self.send({"op": OP_INVALID_SESSION, "d": False})
+
+    async def identify(self, data):
+        args = self.sim.args
+        shard = data.get("shard")
+        if shard is None and args.shards > 1:
+            await self.close(4011, "Sharding required")
+            return
+        shard_id, shard_count = (int(shard[0]), int(shard[1])) if shard else (0, 1)
+        if shard_count != args.shards or not 0 <= shard_id < shard_count:
+            await self.close(4010, "Invalid shard")
+            return
+
+        # One IDENTIFY per rate-limit bucket per window
+        bucket = shard_id % args.max_concurrency
+        last = self.sim.identify_times.get(bucket)
+        if last is not None and now_ms() - last < IDENTIFY_WINDOW_MS:
+            self.sim.stats.identify_rate_limited += 1
+            print(f"Shard {shard_id} identified too soon for bucket {bucket}")
+            await self.send({"op": OP_INVALID_SESSION, "d": False})
+            return
+        self.sim.identify_times[bucket] = now_ms()
+
+        self.sim.stats.identifies += 1
+        self.shard = shard_id
+        self.sim.shard_by_host[self.peer_host] = shard_id
+        self.session_id = base64.b16encode(os.urandom(16)).decode().lower()
+        self.sim.resumable[self.session_id] = (0, shard_id)
+        guilds = [g for g in self.sim.guilds if self.sim.shard_of(g) == shard_id]
+        print(f"Shard {shard_id}/{shard_count} identified from {self.peer_host} with {len(guilds)} guilds")
+        await self.dispatch("READY", {
+            "v": 10,
+            "session_id": self.session_id,
+            "resume_gateway_url": self.sim.gateway_url,
+            "shard": [shard_id, shard_count],
+            "user": {"id": self.sim.bot_id, "username": "sim-bot", "bot": True},
+            "guilds": [{"id": g, "unavailable": True} for g in guilds],
+        })
+        for index, guild in enumerate(guilds):
+            await self.dispatch("GUILD_CREATE", self.sim.guild_create(guild, index))
+        self.ready = True
+
+    async def close(self, code=4000, reason="simulated disconnect"):
+        if self.closed:
+            return
+        self.closed = True
+        if self.session_id:
+            self.sim.resumable[self.session_id] = (self.sequence, self.shard)
+        try:
+            ws_close(self.writer, code, reason)
+            await self.writer.drain()
+        except ConnectionError:
+            pass
+        self.writer.close()
+
+
+class Simulator:
+    def __init__(self, args):
+        self.args = args
+        self.stats = Stats()
+        self.snowflakes = SnowflakeGenerator()
+        self.sessions = set()
+        self.writers = set()
+        self.resumable = {}
+        self.identify_times = {}
+        self.shard_by_host = {}
+        self.message_owners = {}
+        self.live_bodies = {}
+        self.buckets = {"bot": RateBucket("sim-messages", args.bot_bucket),
+                        "webhook": RateBucket("sim-webhook", args.webhook_bucket)}
+        self.guilds = [str((GUILD_TIMESTAMP_BASE + i) << 22) for i in range(args.guilds)]
+        self.bot_id = self.snowflakes.next()
+        self.user_id = self.snowflakes.next()
+        self.authors = [str(int(self.user_id) + i) for i in range(max(args.authors, 1))]
+        self.spammer_id = str(int(self.user_id) + 1000000)
+        self.gateway_url = f"ws://{args.advertise_host or args.host}:{args.port}"
+        self.record_file = open(args.record, "w") if args.record else None
+        self.record_started = now_ms()
+
+    def record(self, direction, payload):
+        if self.record_file:
+            entry = {"ms": round(now_ms() - self.record_started, 3), "dir": direction, "frame": payload}
+            self.record_file.write(json.dumps(entry, separators=(",", ":")) + "\n")
+
+    def ready_sessions(self):
+        return [s for s in self.sessions if s.ready and not s.closed]
+
+    def shard_of(self, guild_id):
+        return (int(guild_id) >> 22) % self.args.shards
+
+    def channel_for(self, guild_id):
+        # Every guild's messages use --channel-id so each shard's board acts on them
+        return self.args.channel_id
+
+    def guild_create(self, guild_id, index):
+        """A GUILD_CREATE shaped like a real one: --guild-channels channels and
+        --guild-roles roles with overwrites, topics, permissions and so on."""
+        base = int(guild_id)
+        roles = [{"id": guild_id, "name": "@everyone", "color": 0, "position": 0,
+                  "permissions": "1071698660929", "hoist": False, "managed": False,
+                  "mentionable": False, "icon": None, "unicode_emoji": None, "flags": 0}]
+        for i in range(1, self.args.guild_roles):
+            roles.append({"id": str(base + 100000 + i), "name": f"role-{i}", "color": (i * 2654435761) & 0xFFFFFF,
+                          "position": i, "permissions": str((i * 1099511627) & 0x1FFFFFFFFFF),
+                          "hoist": i % 7 == 0, "managed": False, "mentionable": i % 3 == 0,
+                          "icon": None, "unicode_emoji": None, "flags": 0,
+                          "description": None, "tags": {}})
+        channels = [{"id": self.channel_for(guild_id), "name": "bot", "type": 0, "position": 0,
+                     "parent_id": None, "topic": "Commands for the board", "nsfw": False,
+                     "rate_limit_per_user": 0, "last_message_id": None, "flags": 0,
+                     "permission_overwrites": []}]
+        for i in range(1, self.args.guild_channels):
+            category = i % 25 == 1
+            overwrites = [{"id": roles[(i + k) % len(roles)]["id"], "type": 0,
+                           "allow": "1024" if k else "0", "deny": "0" if k else "2048"}
+                          for k in range(min(3, len(roles)))]
+            channels.append({"id": str(base + 200000 + i), "name": f"channel-{i:04d}",
+                             "type": 4 if category else (2 if i % 9 == 0 else 0), "position": i,
+                             "parent_id": None if category else str(base + 200000 + i - (i - 1) % 25),
+                             "topic": None if category else f"Discussion about topic number {i}, please stay on topic",
+                             "nsfw": False, "rate_limit_per_user": 0 if i % 5 else 10,
+                             "last_message_id": str(base + 300000 + i), "flags": 0,
+                             "permission_overwrites": overwrites})
+        return {
+            "id": guild_id,
+            "name": f"Simulated Guild {index}",
+            "icon": None, "owner_id": self.user_id, "region": "deprecated", "afk_timeout": 300,
+            "verification_level": 1, "default_message_notifications": 1, "explicit_content_filter": 2,
+            "features": ["COMMUNITY", "NEWS", "WELCOME_SCREEN_ENABLED"], "mfa_level": 0,
+            "joined_at": "2024-01-01T00:00:00.000000+00:00", "large": self.args.guild_channels > 250,
+            "unavailable": False, "member_count": 25000, "preferred_locale": "en-US",
+            "roles": roles,
+            "channels": channels,
+            "emojis": [{"id": str(base + 400000 + i), "name": f"emoji_{i}", "roles": [],
+                        "require_colons": True, "managed": False, "animated": False, "available": True}
+                       for i in range(50)],
+            "members": [{"user": {"id": self.bot_id, "username": "sim-bot", "bot": True},
+                         "roles": [], "joined_at": "2024-01-01T00:00:00.000000+00:00", "deaf": False, "mute": False}],
+            "threads": [], "stickers": [], "stage_instances": [], "guild_scheduled_events": [],
+        }
+
+    def session_for_shard(self, shard):
+        for session in self.sessions:
+            if session.ready and not session.closed and session.shard == shard:
+                return session
+        return None
+
+    # HTTP / upgrade handling
+
+    @staticmethod
+    async def read_request(reader):
+        request_line = (await reader.readline()).decode().strip()
+        if not request_line:
+            return None
+        method, target, _ = request_line.split(" ", 2)
+        headers = {}
+        while True:
+            line = (await reader.readline()).decode().strip()
+            if not line:
+                break
+            name, _, value = line.partition(":")
+            headers[name.strip().lower()] = value.strip()
+        return method, target, headers
+
+    async def handle_connection(self, reader, writer):
+        self.writers.add(writer)
+        try:
+            peer_host = (writer.get_extra_info("peername") or ("?",))[0]
+            request = await self.read_request(reader)
+            if request and request[2].get("upgrade", "").lower() == "websocket":
+                await self.handle_gateway(reader, writer, request[2])
+                return
+
+            # Keep-alive loop for plain REST requests
+            while request:
+                method, target, headers = request
+                body = b""
+                if "content-length" in headers:
+                    body = await reader.readexactly(int(headers["content-length"]))
+                status, payload, extra = await self.handle_rest(method, target, headers, body, peer_host)
+                self.write_http(writer, status, payload, extra)
+                await writer.drain()
+                if headers.get("connection", "").lower() == "close":
+                    break
+                request = await self.read_request(reader)
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            pass
+        finally:
+            self.writers.discard(writer)
+            writer.close()
+
+    def write_http(self, writer, status, payload, extra_headers):
+        reasons = {200: "OK", 204: "No Content", 400: "Bad Request", 401: "Unauthorized", 403: "Forbidden",
+                   404: "Not Found", 429: "Too Many Requests"}
+        body = json.dumps(payload).encode() if payload is not None else b""
+        lines = [f"HTTP/1.1 {status} {reasons.get(status, 'OK')}",
+                 "Content-Type: application/json",
+                 f"Content-Length: {len(body)}"]
+        lines += [f"{k}: {v}" for k, v in extra_headers.items()]
+        writer.write(("\r\n".join(lines) + "\r\n\r\n").encode() + body)
+
+    async def handle_rest(self, method, target, headers, body, peer_host):
+        path = urlsplit(target).path.rstrip("/")
+        parts = path.split("/")
+
+        if method == "GET" and path.endswith("/gateway"):
+            return 200, {"url": self.gateway_url}, {}
+        if method == "GET" and path.endswith("/gateway/bot"):
+            return 200, {
+                "url": self.gateway_url,
+                "shards": self.args.shards,
+                "session_start_limit": {"total": 1000, "remaining": 1000, "reset_after": 0,
+                                        "max_concurrency": self.args.max_concurrency},
+            }, {}
+
+        # Bot: /api/v{n}/channels/{id}/messages[/{message_id}]
+        # Webhook: /api/webhooks/{id}/{token}[/messages/{message_id}]
+        if method == "POST" and len(parts) >= 5 and parts[-3] == "channels" and parts[-1] == "messages":
+            return await self.handle_message("bot", parts[-2], None, True, headers, body, peer_host, path)
+        if method == "PATCH" and len(parts) >= 6 and parts[-4] == "channels" and parts[-2] == "messages":
+            return await self.handle_message("bot", parts[-3], parts[-1], True, headers, body, peer_host, path)
+        if method == "POST" and len(parts) >= 5 and parts[-3] == "webhooks":
+            wait = parse_qs(urlsplit(target).query).get("wait", ["false"])[0] == "true"
+            return await self.handle_message("webhook", self.args.channel_id, None, wait, headers, body,
+                                             peer_host, path)
+        if method == "PATCH" and len(parts) >= 7 and parts[-5] == "webhooks" and parts[-2] == "messages":
+            return await self.handle_message("webhook", self.args.channel_id, parts[-1], True, headers, body,
+                                             peer_host, path)
+
+        return 404, {"message": "404: Not Found", "code": 0}, {}
+
+    async def handle_message(self, backend, channel_id, message_id, wait, headers, body, peer_host, path):
+        """Creates (message_id None) or edits a message through the bot or a webhook."""
+        if backend == "bot" and not headers.get("authorization", "").startswith("Bot "):
+            return 401, {"message": "401: Unauthorized", "code": 0}, {}
+        bucket = self.buckets[backend]
+        limited = self.take_bucket(backend)
+        if limited:
+            return limited
+        # Discord acknowledges wait=false webhooks before the message exists
+        if wait and self.args.rest_latency_ms:
+            jitter = random.uniform(0, self.args.rest_jitter_ms)
+            await asyncio.sleep((self.args.rest_latency_ms + jitter) / 1000.0)
+        try:
+            content = json.loads(body or b"{}")
+        except ValueError:
+            return 400, {"message": "Invalid JSON", "code": 50109}, {}
+        self.record("rest", {"method": "PATCH" if message_id else "POST", "path": path, "body": content})
+
+        if message_id is None:
+            message_id = self.snowflakes.next()
+            self.message_owners[message_id] = backend
+            if self.is_live_status(content):
+                # The live status message is not a command reply
+                self.stats.live_posts += 1
+                self.live_bodies[message_id] = content
+            else:
+                self.stats.on_reply(self.shard_by_host.get(peer_host, 0), str(content.get("content", "")),
+                                    self.args.abuse_reply_marker)
+            if not wait:
+                return 204, None, bucket.headers()
+            return 200, {"id": message_id, "channel_id": channel_id,
+                         "content": content.get("content", "")}, bucket.headers()
+
+        owner = self.message_owners.get(message_id)
+        if owner is None:
+            return 404, {"message": "Unknown Message", "code": 10008}, {}
+        if owner != backend:
+            return 403, {"message": "Cannot edit a message authored by another user", "code": 50005}, {}
+        self.stats.live_edits += 1
+        if self.live_bodies.get(message_id) == content:
+            self.stats.live_unchanged_edits += 1
+        self.live_bodies[message_id] = content
+        return 200, {"id": message_id, "channel_id": channel_id,
+                     "content": content.get("content", "")}, bucket.headers()
+
+    def take_bucket(self, backend):
+        # Returns a 429 response when the bucket is empty or --rate-limit-ratio fires
+        bucket = self.buckets[backend]
+        self.stats.bucket_requests[backend] = self.stats.bucket_requests.get(backend, 0) + 1
+        injected = random.random() < self.args.rate_limit_ratio
+        if not injected and bucket.take():
+            return None
+        self.stats.rate_limited += 1
+        self.stats.bucket_limited[backend] = self.stats.bucket_limited.get(backend, 0) + 1
+        retry_after = self.args.retry_after_ms / 1000.0 if injected else bucket.reset_after()
+        return 429, {"message": "You are being rate limited.", "retry_after": retry_after,
+                     "global": False}, {
+            "Retry-After": str(max(1, int(retry_after + 0.999))),
+            "X-RateLimit-Remaining": "0",
+            "X-RateLimit-Reset-After": f"{retry_after:.3f}",
+            "X-RateLimit-Bucket": bucket.bucket_id,
+        }
+
+    @staticmethod
+    def is_live_status(content):
+        embeds = content.get("embeds") or []
+        return any(str(embed.get("title", "")).startswith("📡 Live Status") for embed in embeds)
+
+    async def handle_gateway(self, reader, writer, headers):
+        key = headers.get("sec-websocket-key", "")
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        writer.write((
+            "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+            f"Sec-WebSocket-Accept: {accept}\r\n\r\n").encode())
+        await writer.drain()
+        session = GatewaySession(self, reader, writer)
+        self.sessions.add(session)
+        print(f"Gateway client connected ({len(self.sessions)} active)")
+        await session.run()
+        print("Gateway client disconnected")
+
+    # Traffic generation
+
+    def message_create(self, content, guild_id, author_id=None):
+        return {
+            "id": self.snowflakes.next(),
+            "channel_id": self.channel_for(guild_id),
+            "guild_id": guild_id,
+            "content": content,
+            "author": {"id": author_id or self.user_id, "username": "load-tester", "bot": False},
+        }
+
+    async def deliver(self, event, data, abuse=False):
+        guild_id = data.get("guild_id")
+        shard = self.shard_of(guild_id) if guild_id else 0
+        session = self.session_for_shard(shard)
+        if session is None:
+            self.stats.not_delivered += 1
+            return
+        if abuse:
+            self.stats.abuse_sent += 1
+        elif event == "MESSAGE_CREATE":
+            self.stats.on_dispatch(shard)
+        await session.dispatch(event, data)
+
+    async def wait_for_shards(self):
+        # Wait until every shard that owns a guild has a ready session
+        needed = {self.shard_of(g) for g in self.guilds}
+        while not needed.issubset({s.shard for s in self.ready_sessions()}):
+            await asyncio.sleep(0.1)
+
+    async def load(self):
+        args = self.args
+        commands = [c.strip() for c in args.commands.split(",") if c.strip()]
+        await self.wait_for_shards()
+        print(f"{args.shards} shard(s) ready, driving {args.rate} MESSAGE_CREATE/s "
+              f"across {len(self.guilds)} guild(s) for {args.duration} s")
+        self.stats.reset()
+        abuse = asyncio.create_task(self.abuse()) if args.abuse_burst > 0 else None
+        interval = 1.0 / args.rate
+        start = time.monotonic()
+        sent = 0
+        while time.monotonic() - start < args.duration:
+            due = int((time.monotonic() - start) / interval) + 1
+            while sent < due:
+                guild = self.guilds[sent % len(self.guilds)]
+                author = self.authors[sent % len(self.authors)]
+                await self.deliver("MESSAGE_CREATE", self.message_create(commands[sent % len(commands)], guild, author))
+                sent += 1
+            await asyncio.sleep(min(interval, 0.005))
+        if abuse:
+            abuse.cancel()
+        await self.drain()
+
+    async def abuse(self):
+        # One author floods the first guild's channel in bursts
+        args = self.args
+        commands = [c.strip() for c in args.abuse_commands.split(",") if c.strip()]
+        while True:
+            await asyncio.sleep(args.abuse_every)
+            print(f"Injecting abuse burst of {args.abuse_burst} commands")
+            for i in range(args.abuse_burst):
+                data = self.message_create(commands[i % len(commands)], self.guilds[0], self.spammer_id)
+                await self.deliver("MESSAGE_CREATE", data, abuse=True)
+
+    async def replay(self):
+        args = self.args
+        frames = []
+        with open(args.replay) as capture:
+            for line in capture:
+                entry = json.loads(line)
+                frame = entry.get("frame", {})
+                if entry.get("dir") == "send" and frame.get("op") == OP_DISPATCH and \
+                        frame.get("t") not in ("READY", "RESUMED"):
+                    frames.append((entry["ms"], frame))
+        await self.wait_for_shards()
+        print(f"Replaying {len(frames)} dispatches at {args.replay_speed}x")
+        self.stats.reset()
+        if frames:
+            base = frames[0][0]
+            start = now_ms()
+            for offset, frame in frames:
+                wait = (offset - base) / args.replay_speed - (now_ms() - start)
+                if wait > 0:
+                    await asyncio.sleep(wait / 1000.0)
+                data = frame.get("d") or {}
+                if frame["t"] == "MESSAGE_CREATE":
+                    # Redirect into the configured channel so the device acts on it
+                    data = dict(data, channel_id=self.args.channel_id,
+                                author=dict(data.get("author") or {}, bot=False))
+                await self.deliver(frame["t"], data)
+        await self.drain()
+
+    async def drain(self):
+        self.stats.finished = now_ms()
+        deadline = time.monotonic() + self.args.drain_seconds
+        while self.stats.pending_count() and time.monotonic() < deadline:
+            await asyncio.sleep(0.05)
+        self.stats.report()
+
+    async def shutdown(self):
+        for session in list(self.sessions):
+            await session.close(1000, "simulator shutting down")
+        for writer in list(self.writers):
+            writer.close()
+        await asyncio.sleep(0.1)
+
+    async def chaos(self):
+        args = self.args
+        while True:
+            await asyncio.sleep(1.0)
+            for session in self.ready_sessions():
+                roll = random.random()
+                if args.disconnect_every and roll < 1.0 / args.disconnect_every:
+                    self.stats.disconnects += 1
+                    print("Injecting disconnect")
+                    await session.close()
+                elif args.reconnect_every and roll < 1.0 / args.reconnect_every:
+                    print("Injecting opcode 7 (reconnect)")
+                    await session.send({"op": OP_RECONNECT, "d": None})
+                elif args.invalid_session_every and roll < 1.0 / args.invalid_session_every:
+                    print("Injecting opcode 9 (invalid session)")
+                    await session.send({"op": OP_INVALID_SESSION, "d": random.random() < 0.5})
+
+    async def serve(self, clients=()):
+        server = await asyncio.start_server(self.handle_connection, self.args.host, self.args.port)
+        print(f"Discord simulator listening on {self.args.host}:{self.args.port} "
+              f"(gateway {self.gateway_url})")
+        tasks = [asyncio.create_task(self.chaos())]
+        tasks += [asyncio.create_task(client.run()) for client in clients]
+        async with server:
+            if self.args.replay:
+                await self.replay()
+            elif self.args.rate > 0:
+                await self.load()
+            else:
+                await server.serve_forever()
+            await self.shutdown()
+        for task in tasks:
+            task.cancel()
+        await asyncio.gather(*tasks, return_exceptions=True)
+        if self.record_file:
+            self.record_file.close()
+        return self.stats
+
+
+# --- Emulated shard clients --------------------------------------------------
+
+class EmulatedClient:
+    """Stand-in for one board: a single sequential loop that identifies as a
+    shard and answers each MESSAGE_CREATE with one POST after a fixed cost.
+    Replies go through the bot API or a webhook ("webhook-nowait" for
+    wait=false) and follow the firmware's rate-limit policy: an empty bucket
+    defers the reply (up to DEFERRED_REPLY_SLOTS) instead of blocking."""
+
+    def __init__(self, port, local_host, shard_id, shard_count, cost_ms, backend="bot", max_concurrency=1):
+        self.port = port
+        self.local_host = local_host
+        self.shard = [shard_id, shard_count]
+        self.max_concurrency = max_concurrency
+        self.cost = cost_ms / 1000.0
+        self.backend = backend
+        self.deferred = deque()
+        self.ready_at = 0.0
+        self.rest_lock = asyncio.Lock()
+
+    async def run(self):
+        flusher = None
+        try:
+            reader, writer = await asyncio.open_connection(
+                "127.0.0.1", self.port, local_addr=(self.local_host, 0))
+            key = base64.b64encode(os.urandom(16)).decode()
+            writer.write((
+                "GET /?v=10&encoding=json HTTP/1.1\r\nHost: sim\r\n"
+                "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+            while (await reader.readline()).strip():
+                pass
+            rest_reader, rest_writer = await asyncio.open_connection(
+                "127.0.0.1", self.port, local_addr=(self.local_host, 0))
+            flusher = asyncio.ensure_future(self.flush_deferred(rest_reader, rest_writer))
+
+            while True:
+                payload = json.loads(await ws_read_message(reader, writer, masked_peer=True))
+                if payload.get("op") in (OP_HELLO, OP_INVALID_SESSION):
+                    if payload.get("op") == OP_INVALID_SESSION:
+                        await asyncio.sleep(IDENTIFY_WINDOW_MS / 1000.0)
+                    while not identify_allowed(*self.shard, self.max_concurrency, int(time.time() * 1000)):
+                        await asyncio.sleep(0.05)
+                    identify = {"op": OP_IDENTIFY, "d": {"token": "emulated", "intents": 33281,
+                                                         "shard": self.shard, "properties": {}}}
+                    ws_write_frame(writer, 0x1, json.dumps(identify).encode(), masked=True)
+                elif payload.get("t") == "MESSAGE_CREATE":
+                    await asyncio.sleep(self.cost)
+                    channel_id = payload["d"]["channel_id"]
+                    # Same policy as DiscordClient: never wait for a bucket,
+                    # hold the reply and send it from the loop after the reset
+                    if self.deferred or time.monotonic() < self.ready_at:
+                        self.defer(channel_id)
+                    elif await self.post(rest_reader, rest_writer, channel_id) == 429:
+                        self.defer(channel_id)
+        except (asyncio.IncompleteReadError, ConnectionError, WebSocketClosed):
+            pass
+        finally:
+            if flusher:
+                flusher.cancel()
+
+    def defer(self, channel_id):
+        if len(self.deferred) < DEFERRED_REPLY_SLOTS:
+            self.deferred.append(channel_id)
+
+    async def flush_deferred(self, reader, writer):
+        # Stands in for DiscordClient::update(): one held reply per reset
+        while True:
+            await asyncio.sleep(max(self.ready_at - time.monotonic(), 0.01))
+            if self.deferred and time.monotonic() >= self.ready_at:
+                if await self.post(reader, writer, self.deferred[0]) != 429:
+                    self.deferred.popleft()
+
+    async def post(self, reader, writer, channel_id):
+        body = b'{"content":"ok"}'
+        if self.backend == "bot":
+            request = f"POST /api/v10/channels/{channel_id}/messages HTTP/1.1\r\nAuthorization: Bot emulated\r\n"
+        else:
+            query = "" if self.backend == "webhook-nowait" else "?wait=true"
+            request = f"POST /api/webhooks/{EMULATED_WEBHOOK}{query} HTTP/1.1\r\n"
+        async with self.rest_lock:
+            writer.write((
+                request + "Host: sim\r\nContent-Type: application/json\r\n"
+                f"Content-Length: {len(body)}\r\n\r\n").encode() + body)
+            status = int((await reader.readline()).split()[1])
+            headers = {}
+            while True:
+                line = (await reader.readline()).decode().strip()
+                if not line:
+                    break
+                name, _, value = line.partition(":")
+                headers[name.lower()] = value.strip()
+            await reader.readexactly(int(headers.get("content-length", 0)))
+        if headers.get("x-ratelimit-remaining") == "0" or status == 429:
+            self.ready_at = time.monotonic() + float(headers.get("x-ratelimit-reset-after", 0))
+        return status
+
+
+async def shard_bench(args):
+    """Runs the same offered load against 1, 2, 4, ... emulated shard clients.
+
+    The clients are coroutines that sleep a fixed cost per command, so the
+    speedup is linear by construction and says nothing about the firmware.
+    What it does check is the IDENTIFY schedule: the clients pace with
+    identify_allowed(), the formula DiscordClient::isIdentifyAllowed uses,
+    and the run fails if the simulator saw two same-bucket IDENTIFYs within
+    one 5 s window."""
+    results = []
+    shard_counts = []
+    count = 1
+    while count <= args.max_shards:
+        shard_counts.append(count)
+        count *= 2
+    if shard_counts[-1] != args.max_shards:
+        shard_counts.append(args.max_shards)
+
+    for shards in shard_counts:
+        sim_args = argparse.Namespace(**vars(args))
+        sim_args.shards = shards
+        sim_args.guilds = max(args.guilds, shards)
+        sim = Simulator(sim_args)
+        # Distinct loopback source addresses let the simulator attribute REST replies
+        clients = [EmulatedClient(args.port, f"127.0.0.{i + 2}", i, shards, args.client_cost_ms,
+                                  max_concurrency=args.max_concurrency)
+                   for i in range(shards)]
+        stats = await sim.serve(clients)
+        results.append((shards, stats))
+
+    print("\n=== Shard scaling ===")
+    print(f"Offered load {args.rate:.0f} MESSAGE_CREATE/s, {args.client_cost_ms} ms per command per board")
+    print("shards  handled/s  speedup  p50 ms  p99 ms  dropped  identify too soon")
+    baseline = results[0][1].throughput() or 1.0
+    for shards, stats in results:
+        print(f"{shards:6d}  {stats.throughput():9.0f}  {stats.throughput() / baseline:6.2f}x  "
+              f"{stats.percentile(50):6.0f}  {stats.percentile(99):6.0f}  "
+              f"{stats.pending_count() + stats.not_delivered:7d}  {stats.identify_rate_limited:16d}")
+    collisions = sum(stats.identify_rate_limited for _, stats in results)
+    if collisions:
+        print(f"FAIL: {collisions} IDENTIFY(s) landed in a window their bucket had already used")
+        sys.exit(1)
+    print(f"IDENTIFY schedule OK (max_concurrency {args.max_concurrency}); "
+          "throughput columns describe the simulator, not the firmware")
+
+
+async def send_bench(args):
+    """Runs the same offered load with replies sent via the bot API, a webhook
+    and a wait=false webhook, each with its own rate-limit bucket."""
+    results = []
+    for backend in ("bot", "webhook", "webhook-nowait"):
+        sim_args = argparse.Namespace(**vars(args))
+        sim_args.shards = 1
+        sim_args.max_concurrency = 1
+        sim = Simulator(sim_args)
+        stats = await sim.serve([EmulatedClient(args.port, "127.0.0.2", 0, 1, args.client_cost_ms, backend)])
+        results.append((backend, stats))
+
+    print("\n=== Send backends ===")
+    print(f"Offered load {args.rate:.0f} MESSAGE_CREATE/s, buckets: bot {args.bot_bucket or 'unlimited'}, "
+          f"webhook {args.webhook_bucket or 'unlimited'}, REST latency {args.rest_latency_ms:.0f} ms")
+    print("backend         handled/s  p50 ms  p99 ms  429s  backlog")
+    for backend, stats in results:
+        print(f"{backend:14s}  {stats.throughput():9.1f}  {stats.percentile(50):6.0f}  "
+              f"{stats.percentile(99):6.0f}  {stats.rate_limited:4d}  "
+              f"{stats.pending_count() + stats.not_delivered:7d}")
+
+
+# --- Real gateway capture ----------------------------------------------------
+
+async def capture(args):
+    """Connects to the real Discord gateway and records dispatches for replay."""
+    context = ssl.create_default_context()
+    reader, writer = await asyncio.open_connection("gateway.discord.gg", 443, ssl=context)
+    key = base64.b64encode(os.urandom(16)).decode()
+    writer.write((
+        "GET /?v=10&encoding=json HTTP/1.1\r\nHost: gateway.discord.gg\r\n"
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+        f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+    await writer.drain()
+    while (await reader.readline()).strip():
+        pass
+
+    def send(payload):
+        ws_write_frame(writer, 0x1, json.dumps(payload).encode(), masked=True)
+
+    started = now_ms()
+    sequence = None
+    count = 0
+
+    async def heartbeat(interval_ms):
+        # Own task, so reads are never cancelled halfway through a frame
+        while True:
+            send({"op": OP_HEARTBEAT, "d": sequence})
+            await asyncio.sleep(interval_ms / 1000.0)
+
+    async def record(out):
+        nonlocal sequence, count
+        while True:
+            payload = json.loads(await ws_read_message(reader, writer, masked_peer=True))
+            if payload.get("s") is not None:
+                sequence = payload["s"]
+            if payload.get("op") == OP_HELLO:
+                heartbeats.append(asyncio.ensure_future(heartbeat(payload["d"]["heartbeat_interval"])))
+                send({"op": OP_IDENTIFY, "d": {
+                    "token": args.token, "intents": args.intents,
+                    "properties": {"os": "linux", "browser": "discord-sim", "device": "discord-sim"}}})
+            elif payload.get("op") == OP_DISPATCH:
+                out.write(json.dumps({"ms": round(now_ms() - started, 3), "dir": "send",
+                                      "frame": payload}, separators=(",", ":")) + "\n")
+                count += 1
+
+    heartbeats = []
+    with open(args.output, "w") as out:
+        try:
+            # The capture ends here, so abandoning a partial frame is harmless
+            await asyncio.wait_for(record(out), timeout=args.seconds)
+        except asyncio.TimeoutError:
+            pass
+        finally:
+            for task in heartbeats:
+                task.cancel()
+    ws_close(writer, 1000, "capture complete", masked=True)
+    writer.close()
+    print(f"Captured {count} dispatches to {args.output}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    def add_common(command):
+        command.add_argument("--host", default="0.0.0.0")
+        command.add_argument("--port", type=int, default=8080)
+        command.add_argument("--advertise-host", help="host name returned in gateway URLs")
+        command.add_argument("--channel-id", default="100000000000000001")
+        command.add_argument("--guilds", type=int, default=1, help="simulated guilds spread over shards")
+        command.add_argument("--guild-channels", type=int, default=500, help="channels in each GUILD_CREATE")
+        command.add_argument("--guild-roles", type=int, default=100, help="roles in each GUILD_CREATE")
+        command.add_argument("--heartbeat-ms", type=int, default=41250)
+        command.add_argument("--commands", default="status", help="comma-separated message contents to cycle")
+        command.add_argument("--drain-seconds", type=float, default=5.0, help="wait for replies after load")
+        command.add_argument("--rest-latency-ms", type=float, default=0)
+        command.add_argument("--rest-jitter-ms", type=float, default=0)
+        command.add_argument("--rate-limit-ratio", type=float, default=0, help="fraction of POSTs answered 429")
+        command.add_argument("--retry-after-ms", type=float, default=1000)
+        command.add_argument("--bot-bucket", default="", help="bot message rate limit, e.g. 5/5 (empty = unlimited)")
+        command.add_argument("--webhook-bucket", default="", help="webhook rate limit, e.g. 5/2 (empty = unlimited)")
+        command.add_argument("--disconnect-every", type=float, default=0, help="mean seconds between disconnects")
+        command.add_argument("--reconnect-every", type=float, default=0, help="mean seconds between opcode 7")
+        command.add_argument("--invalid-session-every", type=float, default=0,
+                             help="mean seconds between opcode 9")
+        command.add_argument("--record", help="write all gateway and REST traffic to a JSONL capture")
+        command.add_argument("--authors", type=int, default=1, help="distinct users sending the load")
+        command.add_argument("--abuse-burst", type=int, default=0, help="spam commands per abuse burst (0 = off)")
+        command.add_argument("--abuse-every", type=float, default=10.0, help="seconds between abuse bursts")
+        command.add_argument("--abuse-commands", default="red", help="comma-separated spam contents")
+        command.add_argument("--abuse-reply-marker", default="LED set to red",
+                             help="text identifying replies to spam commands")
+
+    serve = sub.add_parser("serve", help="run the simulated gateway and REST API")
+    add_common(serve)
+    serve.add_argument("--shards", type=int, default=1, help="shard count clients must identify with")
+    serve.add_argument("--max-concurrency", type=int, default=1, help="identify buckets per 5 s window")
+    serve.add_argument("--rate", type=float, default=0, help="MESSAGE_CREATE per second (0 = idle)")
+    serve.add_argument("--duration", type=float, default=10.0, help="load duration in seconds")
+    serve.add_argument("--replay", help="replay dispatches from a JSONL capture instead of --rate")
+    serve.add_argument("--replay-speed", type=float, default=1.0)
+
+    bench = sub.add_parser("shard-bench", help="check the IDENTIFY schedule with 1..N emulated (not real) clients")
+    add_common(bench)
+    bench.add_argument("--max-shards", type=int, default=4)
+    bench.add_argument("--max-concurrency", type=int, default=1, help="identify buckets, as from /gateway/bot")
+    bench.add_argument("--client-cost-ms", type=float, default=5.0, help="emulated per-command cost per board")
+    bench.add_argument("--rate", type=float, default=2000)
+    bench.add_argument("--duration", type=float, default=5.0)
+    bench.set_defaults(replay=None, drain_seconds=1.0)
+
+    send = sub.add_parser("send-bench", help="compare reply throughput via the bot API and a webhook")
+    add_common(send)
+    send.add_argument("--client-cost-ms", type=float, default=5.0, help="emulated per-command cost")
+    send.add_argument("--rate", type=float, default=10)
+    send.add_argument("--duration", type=float, default=10.0)
+    send.set_defaults(replay=None, drain_seconds=1.0, bot_bucket="5/5", webhook_bucket="5/2", rest_latency_ms=80)
+
+    cap = sub.add_parser("capture", help="record dispatches from the real Discord gateway")
+    cap.add_argument("--token", required=True)
+    cap.add_argument("--intents", type=int, default=33281, help="same as the firmware's IDENTIFY")
+    cap.add_argument("--seconds", type=float, default=60)
+    cap.add_argument("-o", "--output", default="capture.jsonl")
+
+    args = parser.parse_args()
+    try:
+        if args.mode == "serve":
+            asyncio.run(Simulator(args).serve())
+        elif args.mode == "shard-bench":
+            asyncio.run(shard_bench(args))
+        elif args.mode == "send-bench":
+            asyncio.run(send_bench(args))
+        else:
+            asyncio.run(capture(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
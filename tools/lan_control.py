@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Send commands to the bot over the LAN control plane (UDP).
+
+Each datagram is one command; the device answers with the same JSON payload
+it would post to Discord. Round-trip times are measured on this machine.
+
+Examples:
+  python3 tools/lan_control.py 192.168.1.42 "color #ff8800" --key "$KEY"
+  python3 tools/lan_control.py 192.168.1.42 status --key "$KEY" --repeat 200 --compare
+"""
+
+import argparse
+import json
+import socket
+import time
+
+
+def send(sock, address, key, command, timeout):
+    payload = f"{key} {command}"
+    started = time.perf_counter()
+    sock.sendto(payload.encode(), address)
+    sock.settimeout(timeout)
+    data, _ = sock.recvfrom(4096)
+    return (time.perf_counter() - started) * 1000.0, json.loads(data)
+
+
+def render(reply):
+    lines = [reply.get("content", "")] if reply.get("content") else []
+    for embed in reply.get("embeds", []):
+        lines.append(embed.get("title", ""))
+        if embed.get("description"):
+            lines.append(embed["description"])
+        for field in embed.get("fields", []):
+            lines.append(f"  {field['name']}: {field['value']}".replace("\n", " | "))
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("command")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--key", required=True, help="LOCAL_CONTROL_KEY configured on the device")
+    parser.add_argument("--repeat", type=int, default=1)
+    parser.add_argument("--timeout", type=float, default=2.0)
+    parser.add_argument("--compare", action="store_true", help="print the device's LAN vs Discord latency")
+    args = parser.parse_args()
+
+    address = (args.host, args.port)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rtts = []
+    lost = 0
+    reply = None
+    for _ in range(args.repeat):
+        try:
+            rtt, reply = send(sock, address, args.key, args.command, args.timeout)
+            rtts.append(rtt)
+        except socket.timeout:
+            lost += 1
+
+    if reply is not None:
+        print(render(reply))
+    if rtts:
+        rtts.sort()
+        print(f"\nRound trip over {len(rtts)} commands ({lost} lost): "
+              f"p50={rtts[len(rtts) // 2]:.1f} ms p99={rtts[min(len(rtts) - 1, int(len(rtts) * 0.99))]:.1f} ms "
+              f"max={rtts[-1]:.1f} ms")
+    else:
+        print("No reply received")
+
+    if args.compare:
+        _, latency = send(sock, address, args.key, "latency", args.timeout)
+        print("\n" + render(latency))
+
+
+if __name__ == "__main__":
+    main()